@@ -0,0 +1,169 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef DGATE_BYTE_RING_H
+#define DGATE_BYTE_RING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <sys/uio.h>
+
+// Fixed capacity byte FIFO for socket buffers. Data and free space are
+// each at most two pieces, so reads and writes can go straight to and
+// from the ring with readv()/writev().
+template<size_t N>
+class byte_ring {
+	static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+	static constexpr size_t capacity = N;
+
+	size_t size() const
+	{
+		return tail_ - head_;
+	}
+
+	size_t space() const
+	{
+		return N - size();
+	}
+
+	bool empty() const
+	{
+		return head_ == tail_;
+	}
+
+	void clear()
+	{
+		head_ = tail_ = scanned_ = 0;
+	}
+
+	// The stored bytes, oldest first. Returns the number of iovecs used.
+	int data(iovec iov[2]) const
+	{
+		return split(iov, head_, size());
+	}
+
+	// The free space, to read into and then produce().
+	int free(iovec iov[2])
+	{
+		return split(iov, tail_, space());
+	}
+
+	void produce(size_t n)
+	{
+		tail_ += n;
+	}
+
+	void consume(size_t n)
+	{
+		head_ += n;
+		if (scanned_ < head_) scanned_ = head_;
+	}
+
+	// All or nothing.
+	bool write(const void* src, size_t n)
+	{
+		if (n > space()) return false;
+
+		iovec iov[2];
+		int count = free(iov);
+		auto p = static_cast<const char*>(src);
+		for (int i = 0; i < count && n > 0; i++) {
+			size_t len = std::min(n, iov[i].iov_len);
+			std::memcpy(iov[i].iov_base, p, len);
+			p += len;
+			n -= len;
+			tail_ += len;
+		}
+		return true;
+	}
+
+	// Length of the first line including its terminator c, or 0 if
+	// there isn't a whole one yet. Bytes already searched aren't
+	// searched again, so consume() the line before asking for the next.
+	size_t line(char c = '\n')
+	{
+		while (scanned_ != tail_) {
+			size_t pos = scanned_ & (N - 1);
+			size_t len = std::min(tail_ - scanned_, N - pos);
+			auto hit = static_cast<const char*>(std::memchr(buf_ + pos, c, len));
+			if (hit != nullptr) {
+				scanned_ += hit - (buf_ + pos) + 1;
+				return scanned_ - head_;
+			}
+			scanned_ += len;
+		}
+		return 0;
+	}
+
+	// The first n bytes in one piece. Only copied into scratch (which
+	// must hold n bytes) if they wrap around the end.
+	std::string_view view(size_t n, char* scratch) const
+	{
+		size_t pos = head_ & (N - 1);
+		if (pos + n <= N) return {buf_ + pos, n};
+
+		size_t first = N - pos;
+		std::memcpy(scratch, buf_ + pos, first);
+		std::memcpy(scratch + first, buf_, n - first);
+		return {scratch, n};
+	}
+
+private:
+	int split(iovec iov[2], size_t from, size_t n) const
+	{
+		if (n == 0) return 0;
+
+		size_t pos = from & (N - 1);
+		size_t first = std::min(n, N - pos);
+		iov[0].iov_base = const_cast<char*>(buf_ + pos);
+		iov[0].iov_len = first;
+		if (first == n) return 1;
+
+		iov[1].iov_base = const_cast<char*>(buf_);
+		iov[1].iov_len = n - first;
+		return 2;
+	}
+
+	char buf_[N];
+	// Free running; only their difference and low bits matter.
+	size_t head_ = 0;
+	size_t tail_ = 0;
+	size_t scanned_ = 0;
+};
+
+#endif
@@ -36,42 +36,169 @@
 #define DGATE_CXX_SOCK_H
 
 #include <arpa/inet.h>
-#include <iostream>
+#include <cstdint>
+#include <cstring>
 #include <netinet/in.h>
-#include <string>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <utility>
+#include <vector>
 
-static inline constexpr bool sockaddr_addr_equal(const sockaddr_storage* one, const sockaddr_storage* two)
-{
-	if (one->ss_family != two->ss_family) return false;
-
-	std::string sa("A");
-	std::string sb("B");
-
-	switch (one->ss_family) {
-	case AF_INET: {
-		auto a = reinterpret_cast<const sockaddr_in*>(one);
-		auto b = reinterpret_cast<const sockaddr_in*>(two);
-		sa.resize(INET_ADDRSTRLEN);
-		sb.resize(INET_ADDRSTRLEN);
-		inet_ntop(AF_INET, &a->sin_addr, sa.data(), INET_ADDRSTRLEN);
-		inet_ntop(AF_INET, &b->sin_addr, sb.data(), INET_ADDRSTRLEN);
-		std::cout << sa << " " << sb << std::endl;
-		return sa == sb;
-	} break;
-
-	case AF_INET6: {
-		auto a = reinterpret_cast<const sockaddr_in6*>(one);
-		auto b = reinterpret_cast<const sockaddr_in6*>(two);
-		sa.resize(INET6_ADDRSTRLEN);
-		sb.resize(INET6_ADDRSTRLEN);
-		inet_ntop(AF_INET6, &a->sin6_addr, sa.data(), INET6_ADDRSTRLEN);
-		inet_ntop(AF_INET6, &b->sin6_addr, sb.data(), INET6_ADDRSTRLEN);
-		return sa == sb;
-	} break;
+// A normalized binary peer address: IPv4 addresses are stored v4-mapped,
+// so the same host compares equal whichever socket it arrived on.
+struct peer_key {
+	uint64_t addr[2];
+	uint16_t port;// Network order
+
+	peer_key() = default;
+
+	explicit peer_key(const sockaddr_storage& ss) : addr{0, 0}, port(0)
+	{
+		uint8_t bytes[16] = {};
+
+		switch (ss.ss_family) {
+		case AF_INET: {
+			auto sin = reinterpret_cast<const sockaddr_in*>(&ss);
+			bytes[10] = 0xFF;
+			bytes[11] = 0xFF;
+			std::memcpy(bytes + 12, &sin->sin_addr, 4);
+			port = sin->sin_port;
+		} break;
+
+		case AF_INET6: {
+			auto sin6 = reinterpret_cast<const sockaddr_in6*>(&ss);
+			std::memcpy(bytes, &sin6->sin6_addr, 16);
+			port = sin6->sin6_port;
+		} break;
+		}
+
+		std::memcpy(addr, bytes, 16);
+	}
+
+	constexpr bool operator==(const peer_key&) const = default;
+
+	constexpr size_t hash() const
+	{
+		uint64_t h = addr[0] * 0x9E3779B97F4A7C15ULL;
+		h ^= addr[1] + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+		h ^= port;
+		h *= 0xBF58476D1CE4E5B9ULL;
+		return h ^ (h >> 31);
+	}
+};
+
+// Open addressing (linear probing) map from peer_key to T. Lookups
+// neither allocate nor chase pointers; erase shifts entries back instead
+// of leaving tombstones.
+template <typename T>
+class peer_table {
+public:
+	peer_table() : slots_(16), size_(0) {}
+
+	T* find(const peer_key& k)
+	{
+		for (size_t i = index(k);; i = next(i)) {
+			if (!slots_[i].used) return nullptr;
+			if (slots_[i].key == k) return &slots_[i].value;
+		}
+	}
+
+	const T* find(const peer_key& k) const
+	{
+		return const_cast<peer_table*>(this)->find(k);
+	}
+
+	bool contains(const peer_key& k) const
+	{
+		return find(k) != nullptr;
+	}
+
+	// Inserts a default T if the key isn't present.
+	T& operator[](const peer_key& k)
+	{
+		if ((size_ + 1) * 2 > slots_.size()) grow();
+
+		size_t i = index(k);
+		for (; slots_[i].used; i = next(i)) {
+			if (slots_[i].key == k) return slots_[i].value;
+		}
+
+		slots_[i].used = true;
+		slots_[i].key = k;
+		slots_[i].value = T();
+		size_++;
+		return slots_[i].value;
 	}
-	return false;
-}
+
+	bool erase(const peer_key& k)
+	{
+		size_t i = index(k);
+		for (;; i = next(i)) {
+			if (!slots_[i].used) return false;
+			if (slots_[i].key == k) break;
+		}
+
+		// Move back any entry that probed past the hole.
+		size_t hole = i;
+		for (size_t j = next(i); slots_[j].used; j = next(j)) {
+			size_t home = index(slots_[j].key);
+			if (((j - home) & mask()) >= ((j - hole) & mask())) {
+				slots_[hole] = std::move(slots_[j]);
+				hole = j;
+			}
+		}
+
+		slots_[hole].used = false;
+		slots_[hole].value = T();
+		size_--;
+		return true;
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+	template <typename F>
+	void for_each(F f)
+	{
+		for (auto& s : slots_)
+			if (s.used) f(s.key, s.value);
+	}
+
+private:
+	struct slot {
+		peer_key key;
+		bool used = false;
+		T value = T();
+	};
+
+	size_t mask() const
+	{
+		return slots_.size() - 1;
+	}
+
+	size_t index(const peer_key& k) const
+	{
+		return k.hash() & mask();
+	}
+
+	size_t next(size_t i) const
+	{
+		return (i + 1) & mask();
+	}
+
+	void grow()
+	{
+		std::vector<slot> old(slots_.size() * 2);
+		std::swap(old, slots_);
+		size_ = 0;
+		for (auto& s : old)
+			if (s.used) (*this)[s.key] = std::move(s.value);
+	}
+
+	std::vector<slot> slots_;
+	size_t size_;
+};
 
 #endif
@@ -34,11 +34,17 @@
 #include <string_view> /* for std::string_view */
 #include <limits>      /* for std::numeric_limits<> */
 #include <memory>      /* for std::addressof */
+#include <type_traits> /* for std::is_trivially_copyable_v */
 
 namespace lmdb {
   using mode = mdb_mode_t;
 }
 
+namespace lmdb {
+  template<typename T>
+  static inline const T* view_from_sv(std::string_view v);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /* Error Handling */
 
@@ -1436,6 +1442,25 @@ public:
     return ret;
   }
 
+  /**
+   * Retrieves a fixed-layout value without copying it.
+   *
+   * The returned pointer points into the memory map and stays valid until
+   * the transaction ends or the record is written to.
+   *
+   * @param txn a transaction handle
+   * @param key
+   * @return a pointer to the value, or nullptr if the key is missing
+   * @throws lmdb::error on failure, or if the value has the wrong size
+   */
+  template<typename T>
+  const T* get_as(MDB_txn* const txn,
+                  const std::string_view key) {
+    std::string_view data;
+    if (!get(txn, key, data)) return nullptr;
+    return view_from_sv<T>(data);
+  }
+
   /**
    * Stores a key/value pair into this database.
    *
@@ -1643,6 +1668,22 @@ public:
     return ret;
   }
 
+  /**
+   * Retrieves a key and a fixed-layout value without copying the value.
+   *
+   * @param key
+   * @param op
+   * @return a pointer into the memory map, or nullptr if nothing matched
+   * @throws lmdb::error on failure, or if the value has the wrong size
+   */
+  template<typename T>
+  const T* get_as(std::string_view &key,
+                  const MDB_cursor_op op) {
+    std::string_view val;
+    if (!get(key, val, op)) return nullptr;
+    return view_from_sv<T>(val);
+  }
+
   /**
    * Stores key/data pairs into the database. The cursor is positioned at the new item, or on failure usually near it.
    *
@@ -1713,6 +1754,20 @@ namespace lmdb {
     return reinterpret_cast<T*>(const_cast<char*>(v.data()));
   }
 
+  /**
+   * Takes a std::string_view that points into the memory map and views it
+   * as the parameterized type. LMDB only guarantees 2 byte alignment for
+   * values, so the type must be made of bytes.
+   *
+   * @param v
+   */
+  template<typename T>
+  static inline const T* view_from_sv(std::string_view v) {
+    static_assert(std::is_trivially_copyable_v<T> && alignof(T) == 1, "view_from_sv needs a byte-aligned, trivially copyable type");
+    if (v.size() != sizeof(T)) error::raise("view_from_sv", MDB_BAD_VALSIZE);
+    return reinterpret_cast<const T*>(v.data());
+  }
+
   /**
    * Takes a std::string_view and dereferences it, returning a value of the parameterized type.
    *
@@ -0,0 +1,238 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef DGATE_RING_QUEUE_H
+#define DGATE_RING_QUEUE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ev++.h>
+#include <memory>
+#include <optional>
+
+// Bounded lock-free queues for handing work between threads. Elements are
+// moved in and out, and a full queue refuses the push rather than
+// blocking. Capacities are powers of two.
+
+inline constexpr std::size_t cache_line = 64;
+
+// One producer thread, one consumer thread.
+template<typename T, std::size_t N>
+class spsc_queue {
+	static_assert(N != 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+	using value_type = T;
+	static constexpr std::size_t capacity = N;
+
+	spsc_queue() : slots_(std::make_unique<T[]>(N)) {}
+	spsc_queue(const spsc_queue&) = delete;
+	spsc_queue& operator=(const spsc_queue&) = delete;
+
+	bool try_push(T&& v)
+	{
+		auto t = tail_.load(std::memory_order_relaxed);
+		if (t - head_cache_ == N) {
+			head_cache_ = head_.load(std::memory_order_acquire);
+			if (t - head_cache_ == N) return false;
+		}
+		slots_[t & (N - 1)] = std::move(v);
+		tail_.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	std::optional<T> try_pop()
+	{
+		T v;
+		if (!try_pop_bulk(&v, 1)) return {};
+		return v;
+	}
+
+	// Moves up to max elements into out. Returns how many.
+	std::size_t try_pop_bulk(T* out, std::size_t max)
+	{
+		auto h = head_.load(std::memory_order_relaxed);
+		if (tail_cache_ - h < max) tail_cache_ = tail_.load(std::memory_order_acquire);
+		auto n = std::min(max, tail_cache_ - h);
+		for (std::size_t i = 0; i < n; i++)
+			out[i] = std::move(slots_[(h + i) & (N - 1)]);
+		if (n) head_.store(h + n, std::memory_order_release);
+		return n;
+	}
+
+	bool empty() const
+	{
+		return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+	}
+
+private:
+	// Consumer's line.
+	alignas(cache_line) std::atomic<std::size_t> head_{0};
+	std::size_t tail_cache_ = 0;
+	// Producer's line.
+	alignas(cache_line) std::atomic<std::size_t> tail_{0};
+	std::size_t head_cache_ = 0;
+
+	std::unique_ptr<T[]> slots_;
+};
+
+// Any number of producer threads, one consumer thread. Each slot carries a
+// sequence number telling whose turn it is, so producers only contend on
+// claiming a position.
+template<typename T, std::size_t N>
+class mpsc_queue {
+	static_assert(N != 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+	using value_type = T;
+	static constexpr std::size_t capacity = N;
+
+	mpsc_queue() : slots_(std::make_unique<slot[]>(N))
+	{
+		for (std::size_t i = 0; i < N; i++)
+			slots_[i].seq.store(i, std::memory_order_relaxed);
+	}
+	mpsc_queue(const mpsc_queue&) = delete;
+	mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+	bool try_push(T&& v)
+	{
+		auto pos = tail_.load(std::memory_order_relaxed);
+		slot* s;
+		for (;;) {
+			s = &slots_[pos & (N - 1)];
+			auto seq = s->seq.load(std::memory_order_acquire);
+			auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+			if (dif == 0) {
+				if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			}
+			else if (dif < 0) {
+				return false;
+			}
+			else {
+				pos = tail_.load(std::memory_order_relaxed);
+			}
+		}
+		s->value = std::move(v);
+		s->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	std::optional<T> try_pop()
+	{
+		T v;
+		if (!try_pop_bulk(&v, 1)) return {};
+		return v;
+	}
+
+	std::size_t try_pop_bulk(T* out, std::size_t max)
+	{
+		std::size_t n = 0;
+		for (; n < max; n++) {
+			auto& s = slots_[head_ & (N - 1)];
+			if (s.seq.load(std::memory_order_acquire) != head_ + 1) break;
+			out[n] = std::move(s.value);
+			s.seq.store(head_ + N, std::memory_order_release);
+			head_++;
+		}
+		return n;
+	}
+
+	bool empty() const
+	{
+		return slots_[head_ & (N - 1)].seq.load(std::memory_order_acquire) != head_ + 1;
+	}
+
+private:
+	struct slot {
+		std::atomic<std::size_t> seq;
+		T value;
+	};
+
+	alignas(cache_line) std::atomic<std::size_t> tail_{0};
+	alignas(cache_line) std::size_t head_ = 0;
+
+	std::unique_ptr<slot[]> slots_;
+};
+
+// A queue whose consumer sleeps in an event loop. A push only wakes the
+// consumer if it has drained the queue since its last wakeup, so a burst
+// costs one ev::async::send() instead of one per element.
+template<typename Q>
+class signalled_queue : public Q {
+public:
+	using T = typename Q::value_type;
+
+	void set_signal(ev::async* signal)
+	{
+		signal_ = signal;
+	}
+
+	bool push(T&& v)
+	{
+		if (!this->try_push(std::move(v))) return false;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (armed_.load(std::memory_order_relaxed) && armed_.exchange(false, std::memory_order_acq_rel) && signal_)
+			signal_->send();
+		return true;
+	}
+
+	// Called by the consumer on wakeup: hands every element to f, then
+	// re-arms the signal.
+	template<typename F>
+	void drain(F&& f)
+	{
+		std::array<T, 16> batch;
+		for (;;) {
+			std::size_t n;
+			while ((n = this->try_pop_bulk(batch.data(), batch.size())) != 0) {
+				for (std::size_t i = 0; i < n; i++)
+					f(batch[i]);
+			}
+			armed_.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			// Whatever slipped in before the store didn't signal.
+			if (this->empty()) return;
+		}
+	}
+
+private:
+	std::atomic_bool armed_{true};
+	ev::async* signal_ = nullptr;
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include "app.h"
 #include "dgate/dgate.h"
 #include "dgate/g2.h"
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <ev++.h>
@@ -52,12 +53,13 @@ void module::operator()(ev::timer&, int)
 	parent->tx_timeout(name);
 }
 
-app::app(std::string cs, std::unordered_set<char> modules)
+app::app(std::string cs, std::unordered_set<char> modules, std::shared_ptr<lmdb::env> env, std::shared_ptr<lmdb::dbi> zone_ip4, std::shared_ptr<lmdb::dbi> zone_ip6, std::shared_ptr<lmdb::dbi> irc_sync)
 	: loop_(), cs_(cs), g2_sock_v4_(-1), g2_sock_v6_(-1), dgate_sock_(-1),
 	  ev_g2_readable_v4_(loop_), ev_g2_readable_v6_(loop_), ev_dgate_readable_(loop_),
 	  enabled_modules_(modules)
 {
-	cs_.resize(8, ' ');
+	if (env) routes_ = std::make_unique<route_reader>(env, zone_ip4, zone_ip6, irc_sync);
+
 	for (auto m : enabled_modules_) {
 		modules_[m] = std::make_unique<module>(this, m, tx_state(), std::make_shared<ev::timer>(loop_));
 		modules_[m]->timeout->set(1., 1.);// TODO: configurable
@@ -270,6 +272,7 @@ void app::g2_handle_header(const g2_packet& p, size_t, const sockaddr_storage& f
 
 	modules_[dst]->state.tx_id = p.streamid;
 	modules_[dst]->state.from = from;
+	modules_[dst]->state.peer = peer_key(from);
 
 	handle_header(p.header, dst);
 }
@@ -277,6 +280,7 @@ void app::g2_handle_header(const g2_packet& p, size_t, const sockaddr_storage& f
 void app::handle_header(const dv::header& h, char m)
 {
 	modules_[m]->state.header = h;
+	modules_[m]->state.quality.start(loop_.now());
 
 	packet p;
 	p.module = m;
@@ -289,14 +293,17 @@ void app::handle_header(const dv::header& h, char m)
 	write_all_dgate(p, packet_header_size);
 }
 
-void app::g2_handle_voice(const g2_packet& p, size_t, const sockaddr_storage&)
+void app::g2_handle_voice(const g2_packet& p, size_t, const sockaddr_storage& from)
 {
 	auto id = p.streamid;
 	auto seqno = p.ctrl & 0x1FU;// The MSBs are used for signaling
+	peer_key key(from);
 
+	// Streams are tracked per source, so another gateway can't inject
+	// frames by guessing the stream id.
 	char module = 0;
 	for (const auto& m : modules_) {
-		if (m.second->state.tx_id == id && m.second->tx_lock.test()) {
+		if (m.second->state.tx_id == id && m.second->tx_lock.test() && m.second->state.peer == key) {
 			module = m.first;
 			break;
 		}
@@ -311,12 +318,14 @@ void app::g2_handle_voice(const g2_packet& p, size_t, const sockaddr_storage&)
 		mod->timeout->stop();
 	}
 	else {
-		if (next_seqno(mod->state.seqno) != (p.ctrl & 0x1FU)) {
+		auto expected = next_seqno(mod->state.seqno);
+		if (expected != seqno) {
 			std::cerr << "g2 " << id << ": packet received with wrong seqno?" << std::endl;
 			// TODO: fill in blanks with silence? hold a small (1-2
 			// frame) buffer to detect out of ordering?
 			mod->state.seqno = prev_seqno(seqno);
 		}
+		mod->state.quality.arrival(loop_.now(), seqno_gap(expected, seqno));
 		mod->timeout->again();
 		handle_voice(p.frame, module);
 	}
@@ -329,15 +338,42 @@ void app::handle_voice(const dv::rf_frame& v, char m)
 	state.count++;
 	state.seqno = next_seqno(state.seqno);
 
-	// TODO: dv fast data shouldn't be decoded
+	// Fast data frames carry data in the voice field, so decoding them
+	// would "correct" the data. Pass them through untouched.
+	if (state.seqno != 0 && !v.is_sync() && !v.is_preend()) {
+		uint8_t miniheader = state.miniheader;
+		if (state.seqno % 2 == 1) miniheader = v.data[0] ^ dv::rf_data_scram[0];
+
+		if (dv::is_fastdata(miniheader)) {
+			state.miniheader = state.seqno % 2 == 1 ? miniheader : 0;
+
+			packet p;
+			p.type = P_VOICE;
+			p.module = m;
+			p.voice.count = state.count;
+			p.voice.id = state.tx_id;
+			p.voice.seqno = state.seqno;
+			p.voice.f = v;
+			if (state.local) p.flags = P_LOCAL;
+
+			write_all_dgate(p, packet_voice_size);
+			if (state.seqno == 20) write_quality(m);
+			return;
+		}
+	}
+
 	auto f = v.decode();
 	state.bit_errors += f.bit_errors;
+	state.quality.decoded(f.bit_errors);
 
 	// Sequence 0 packet should ALWAYS be a sync packet.
 	if (f.is_sync() && state.seqno != 0) {
 		std::cerr << "module " << m << " is not seqno 0 but sync data frame received" << std::endl;
 		state.seqno = 0;
 	}
+	else if (state.seqno == 0 && !f.is_sync() && !f.is_preend()) {
+		state.quality.sync_miss();
+	}
 	//std::cout << f.data << " ";
 
 	// Parse miniheader if needed.
@@ -362,7 +398,7 @@ void app::handle_voice(const dv::rf_frame& v, char m)
 			break;
 		case dv::F_FASTDATA_1:
 		case dv::F_FASTDATA_2:
-			// TODO: determine this
+			// Passed through before decoding.
 			break;
 		case dv::F_DSQL:
 			// TODO: this is probably not needed to be parsed
@@ -388,7 +424,7 @@ void app::handle_voice(const dv::rf_frame& v, char m)
 			break;
 		case dv::F_FASTDATA_1:
 		case dv::F_FASTDATA_2:
-			// TODO: determine this
+			// Passed through before decoding.
 			break;
 		case dv::F_DSQL:
 			// TODO: this is probably not needed to be parsed
@@ -409,6 +445,23 @@ void app::handle_voice(const dv::rf_frame& v, char m)
 	if (state.local) p.flags = P_LOCAL;
 
 	write_all_dgate(p, packet_voice_size);
+
+	// Once per superframe.
+	if (state.seqno == 20) write_quality(m);
+}
+
+void app::write_quality(char m)
+{
+	auto& state = modules_[m]->state;
+
+	packet p;
+	p.type = P_QUALITY;
+	p.module = m;
+	p.quality.id = state.tx_id;
+	p.quality.quality = state.quality.summary();
+	if (state.local) p.flags = P_LOCAL;
+
+	write_all_dgate(p, packet_quality_size);
 }
 
 void app::handle_voice_end(const dv::rf_frame& v, char m)
@@ -428,6 +481,7 @@ void app::handle_voice_end(const dv::rf_frame& v, char m)
 	p.voice_end.seqno = state.seqno;
 	p.voice_end.f = f.encode();
 	p.voice_end.bit_errors = state.bit_errors;
+	p.voice_end.quality = state.quality.summary();
 	if (state.local) p.flags = P_LOCAL;
 
 	std::cout << "END TX: " << std::to_string(state.bit_errors) << " " << std::to_string(state.count) << " " << std::to_string(state.tx_id) << std::endl;
@@ -522,6 +576,11 @@ void app::dgate_client_readable(ev::io& watcher, int)
 		return;
 	}
 
+	if (count == packet_route_query_size && p.type == P_ROUTE_QUERY) {
+		handle_route_query(fd, p.route_query);
+		return;
+	}
+
 	if (!enabled_modules_.contains(p.module)) return;
 
 	auto& mod = modules_[p.module];
@@ -537,11 +596,13 @@ void app::dgate_client_readable(ev::io& watcher, int)
 	}
 	else if (count == packet_voice_size) {
 		if (mod->state.tx_id != p.voice.id || !mod->tx_lock.test()) return;
-		if (p.voice.seqno != next_seqno(mod->state.seqno)) {
+		auto expected = next_seqno(mod->state.seqno);
+		if (p.voice.seqno != expected) {
 			std::cerr << "dgate_client_handle_packet(): voice packet with wrong seqno received" << std::endl;
 			// TODO: reconstruct?
 			mod->state.seqno = prev_seqno(p.voice.seqno);
 		}
+		mod->state.quality.arrival(loop_.now(), seqno_gap(expected, p.voice.seqno));
 
 		mod->timeout->again();
 		handle_voice(p.voice.f, p.module);
@@ -583,6 +644,50 @@ void app::write_all_dgate(const packet& p, std::size_t len)
 	}
 }
 
+// Makes room in a full route cache: drops the expired answers, or if
+// none have expired, the one closest to expiring.
+static void evict_route(std::unordered_map<dv::callsign, cached_route>& routes, ev::tstamp now)
+{
+	if (std::erase_if(routes, [now](const auto& r) { return r.second.expires <= now; }) != 0) return;
+
+	auto oldest = std::min_element(routes.begin(), routes.end(), [](const auto& a, const auto& b) { return a.second.expires < b.second.expires; });
+	if (oldest != routes.end()) routes.erase(oldest);
+}
+
+void app::handle_route_query(int fd, const packet_route_query& q)
+{
+	auto conn = std::find_if(dgate_conns_.begin(), dgate_conns_.end(), [fd](const client_connection& c) { return c.fd == fd; });
+	if (conn == dgate_conns_.end()) return;
+
+	auto cs = dv::callsign::from_field(q.cs);
+	auto now = loop_.now();
+
+	auto it = conn->routes.find(cs);
+	if (it == conn->routes.end() || it->second.expires <= now) {
+		if (it == conn->routes.end()) {
+			if (conn->routes.size() >= max_cached_routes) evict_route(conn->routes, now);
+			it = conn->routes.emplace(cs, cached_route{}).first;
+		}
+		auto& c = it->second;
+		c.count = routes_ ? routes_->lookup(cs, c.routes) : 0;
+		c.expires = now + route_ttl;
+	}
+	const auto& c = it->second;
+
+	packet p;
+	p.module = ' ';
+	p.type = P_ROUTE_REPLY;
+	p.flags = {};
+	p.route_reply.id = q.id;
+	std::memcpy(p.route_reply.cs, q.cs, sizeof(q.cs));
+	p.route_reply.count = c.count;
+	std::copy_n(c.routes, c.count, p.route_reply.routes);
+
+	if (write(fd, &p, packet_route_reply_size) == -1) {
+		std::cerr << "handle_route_query(): write(): " << strerror(errno) << std::endl;
+	}
+}
+
 void app::tx_timeout(char m)
 {
 	auto& mod = modules_[m];
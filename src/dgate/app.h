@@ -22,20 +22,32 @@
 #ifndef DGATE_APP_H
 #define DGATE_APP_H
 
+#include "common/c++sock.h"
 #include "dgate/dgate.h"
 #include "dgate/g2.h"
+#include "dgate/quality.h"
+#include "dgate/routes.h"
 #include <ev++.h>
 #include <forward_list>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <sys/socket.h>
+#include <unordered_map>
 #include <unordered_set>
 namespace dgate {
 
+struct cached_route {
+	ev::tstamp expires;
+	uint8_t count;
+	route_addr routes[max_route_addrs];
+};
+
 struct client_connection {
 	int fd;
 	std::unique_ptr<ev::io> watcher;
+	// Route answers already given to this client.
+	std::unordered_map<dv::callsign, cached_route> routes;
 };
 
 struct tx_state {
@@ -43,9 +55,11 @@ struct tx_state {
 	char tx_msg[21];        // might as well null-terminate this
 	dv::header header;
 	sockaddr_storage from;
+	peer_key peer;
 	uint32_t count;     // Total count of packets
 	uint8_t seqno;      // D-star frame count (mod 21)
 	uint32_t bit_errors;// Number of bit errors detected
+	quality_meter quality;
 	uint16_t tx_id;
 	uint8_t miniheader;
 	int serial_pointer;
@@ -70,7 +84,8 @@ class app {
 	friend module;
 
 public:
-	app(std::string cs, std::unordered_set<char> modules);
+	// Route queries are answered from the ircDDB tables if env is set.
+	app(std::string cs, std::unordered_set<char> modules, std::shared_ptr<lmdb::env> env = {}, std::shared_ptr<lmdb::dbi> zone_ip4 = {}, std::shared_ptr<lmdb::dbi> zone_ip6 = {}, std::shared_ptr<lmdb::dbi> irc_sync = {});
 
 	void run();
 
@@ -91,12 +106,15 @@ private:
 	void handle_header(const dv::header& h, char module);
 	void handle_voice(const dv::rf_frame& h, char module);
 	void handle_voice_end(const dv::rf_frame& h, char module);
+	void write_quality(char module);
 
 	void write_all_dgate(const packet& p, std::size_t len);
 
+	void handle_route_query(int fd, const packet_route_query& q);
+
 	ev::dynamic_loop loop_;
 
-	std::string cs_;
+	dv::callsign cs_;
 
 	int g2_sock_v4_;
 	int g2_sock_v6_;
@@ -105,6 +123,10 @@ private:
 
 	std::forward_list<client_connection> dgate_conns_;
 
+	static constexpr ev::tstamp route_ttl = 10.;
+	static constexpr std::size_t max_cached_routes = 1024;// per client
+	std::unique_ptr<route_reader> routes_;
+
 	ev::io ev_g2_readable_v4_;
 	ev::io ev_g2_readable_v6_;
 
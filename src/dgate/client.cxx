@@ -102,6 +102,19 @@ void client::setup()
 
 void client::do_setup() {}
 void client::do_cleanup() {}
+void client::dgate_handle_quality(const packet&, size_t) {}
+void client::dgate_handle_route(const packet&, size_t) {}
+
+void client::dgate_query_route(dv::callsign cs, uint16_t id)
+{
+	packet p;
+	p.module = ' ';
+	p.type = P_ROUTE_QUERY;
+	p.flags = {};
+	p.route_query.id = id;
+	cs.to_field(p.route_query.cs);
+	dgate_reply(p, packet_route_query_size);
+}
 
 void client::dgate_readable(ev::io&, int)
 {
@@ -124,6 +137,8 @@ void client::dgate_readable(ev::io&, int)
 	if (count == dgate::packet_voice_size) return dgate_handle_voice(p, count);
 	if (count == dgate::packet_voice_end_size) return dgate_handle_voice_end(p, count);
 	if (count == dgate::packet_header_size) return dgate_handle_header(p, count);
+	if (count == dgate::packet_quality_size) return dgate_handle_quality(p, count);
+	if (count == dgate::packet_route_reply_size) return dgate_handle_route(p, count);
 }
 
 void client::dgate_reply(const dgate::packet& p, size_t len)
@@ -57,6 +57,11 @@ protected:
 	virtual void dgate_handle_header(const packet& p, size_t len) = 0;
 	virtual void dgate_handle_voice(const packet& p, size_t len) = 0;
 	virtual void dgate_handle_voice_end(const packet& p, size_t len) = 0;
+	virtual void dgate_handle_quality(const packet& p, size_t len);
+	virtual void dgate_handle_route(const packet& p, size_t len);
+
+	// Asks dgate where cs is; answered with dgate_handle_route.
+	void dgate_query_route(dv::callsign cs, uint16_t id);
 
 	void dgate_reply(const dgate::packet& p, size_t len);
 
@@ -43,6 +43,9 @@ enum packet_type : uint8_t {
 	P_VOICE = 0x20U,
 	P_VOICE_END = 0x21U,
 	P_HEADER = 0x10U,
+	P_QUALITY = 0x30U,
+	P_ROUTE_QUERY = 0x40U,
+	P_ROUTE_REPLY = 0x41U,
 };
 
 enum packet_flags : uint8_t {
@@ -56,12 +59,29 @@ static inline constexpr uint8_t next_seqno(uint8_t in)
 	return (in + 1) % 21;
 }
 
-static inline constexpr uint8_t prev_seqno(int8_t in)
+static inline constexpr uint8_t prev_seqno(uint8_t in)
 {
-	return (in - 1) % 21;
+	return (in + 20) % 21;
+}
+
+// Number of frames missing between the expected and received seqno.
+static inline constexpr uint8_t seqno_gap(uint8_t expected, uint8_t got)
+{
+	return (got + 21 - expected) % 21;
 }
 
 #pragma pack(push, 1)
+// Link quality of a stream as seen by dgate.
+struct stream_quality {
+	uint32_t frames;    // Voice frames received
+	uint32_t bit_errors;// Bit errors corrected over the whole stream
+	uint16_t ber;       // Bit error rate of the last 21 frames, in 0.01%
+	uint16_t lost;      // Frames missing from sequence gaps
+	uint16_t late;      // Frames that arrived more than 3 frames late
+	uint16_t sync_miss; // Expected sync frames that weren't
+	uint32_t jitter_us; // Interarrival jitter (RFC 3550) in microseconds
+};
+
 struct packet_voice {
 	uint16_t id;
 	uint8_t count;
@@ -75,6 +95,12 @@ struct packet_voice_end {
 	uint8_t seqno;
 	dv::rf_frame f;
 	uint32_t bit_errors;
+	stream_quality quality;
+};
+
+struct packet_quality {
+	uint16_t id;
+	stream_quality quality;
 };
 
 struct packet_header {
@@ -82,6 +108,30 @@ struct packet_header {
 	dv::header h;
 };
 
+// Where a gateway can be reached, as learned from one ircDDB server.
+struct route_addr {
+	uint8_t server; // Index of the IRC server
+	uint8_t family; // 4 or 6
+	int64_t updated;// Unix time it was last seen
+	uint8_t addr[16];
+};
+
+static constexpr std::size_t max_route_addrs = 4;
+
+// Asks "where is cs?". The module field is ignored.
+struct packet_route_query {
+	uint16_t id;
+	char cs[8];
+};
+
+// count is 0 if the callsign is unknown. The preferred route comes first.
+struct packet_route_reply {
+	uint16_t id;
+	char cs[8];
+	uint8_t count;
+	route_addr routes[max_route_addrs];
+};
+
 struct packet {
 	char title[4];// DGTE
 	char module;
@@ -92,6 +142,9 @@ struct packet {
 		packet_voice voice;
 		packet_voice_end voice_end;
 		packet_header header;
+		packet_quality quality;
+		packet_route_query route_query;
+		packet_route_reply route_reply;
 	};
 
 	packet();
@@ -101,6 +154,15 @@ struct packet {
 static constexpr std::size_t packet_voice_size = 8 + sizeof(packet_voice);
 static constexpr std::size_t packet_voice_end_size = 8 + sizeof(packet_voice_end);
 static constexpr std::size_t packet_header_size = 8 + sizeof(packet_header);
+static constexpr std::size_t packet_quality_size = 8 + sizeof(packet_quality);
+static constexpr std::size_t packet_route_query_size = 8 + sizeof(packet_route_query);
+static constexpr std::size_t packet_route_reply_size = 8 + sizeof(packet_route_reply);
+
+// Packets are told apart by their size.
+static_assert(packet_voice_end_size != packet_header_size);
+static_assert(packet_quality_size != packet_voice_size && packet_quality_size != packet_voice_end_size && packet_quality_size != packet_header_size);
+static_assert(packet_route_query_size != packet_voice_size && packet_route_query_size != packet_voice_end_size && packet_route_query_size != packet_header_size && packet_route_query_size != packet_quality_size);
+static_assert(packet_route_reply_size != packet_voice_size && packet_route_reply_size != packet_voice_end_size && packet_route_reply_size != packet_header_size && packet_route_reply_size != packet_quality_size);
 
 }// namespace dgate
 
@@ -33,27 +33,33 @@ int main()
 	std::shared_ptr<lmdb::env> env = std::make_shared<lmdb::env>(std::move(env_));
 
 	env->set_mapsize(32UL * 1024UL * 1024UL);// 32MB
-	env->set_max_dbs(4);
-	env->open("./test.mdb/");
+	env->set_max_dbs(5);
+	// The route reader keeps one read transaction and renews it on
+	// whatever thread is asking.
+	env->open("./test.mdb/", MDB_NOTLS);
 
 	auto cs_rptr = std::make_shared<lmdb::dbi>();
 	auto zone_ip4 = std::make_shared<lmdb::dbi>();
 	auto zone_ip6 = std::make_shared<lmdb::dbi>();
 	auto zone_nick = std::make_shared<lmdb::dbi>();
+	auto irc_sync = std::make_shared<lmdb::dbi>();
 
 	// Initialize databases
 	{
 		auto wtxn = lmdb::txn::begin(*env);
 		*cs_rptr = lmdb::dbi::open(wtxn, "cs_rptr_dbi", MDB_CREATE);
-		*zone_ip4 = lmdb::dbi::open(wtxn, "zone_ip4", MDB_CREATE);
-		*zone_ip6 = lmdb::dbi::open(wtxn, "zone_ip6", MDB_CREATE);
-		*zone_nick = lmdb::dbi::open(wtxn, "zone_nick", MDB_CREATE);
+		// Binary layouts from ircddb/records.h. The names changed along
+		// with the layout so old text databases are left alone.
+		*zone_ip4 = lmdb::dbi::open(wtxn, "zone_ip4.v2", MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED);
+		*zone_ip6 = lmdb::dbi::open(wtxn, "zone_ip6.v2", MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED);
+		*zone_nick = lmdb::dbi::open(wtxn, "zone_nick.v2", MDB_CREATE);
+		*irc_sync = lmdb::dbi::open(wtxn, "irc_sync", MDB_CREATE);
 
 		wtxn.commit();
 	}
 
 
-	dgate::app app("KO6JXH", {'C'});
+	dgate::app app("KO6JXH", {'C'}, env, zone_ip4, zone_ip6, irc_sync);
 
 	app.run();
 }
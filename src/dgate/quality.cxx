@@ -0,0 +1,101 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "quality.h"
+#include <algorithm>
+#include <cmath>
+
+namespace dgate {
+
+// Each frame has two 24 bit Golay code words.
+static constexpr uint32_t bits_per_frame = 48;
+
+void quality_meter::start(double now)
+{
+	*this = quality_meter();
+	start_time = now;
+}
+
+void quality_meter::arrival(double now, unsigned missing)
+{
+	// A big jump is more likely a frame that got reordered than half a
+	// superframe going missing.
+	if (missing > window / 2) {
+		late++;
+		missing = 0;
+	}
+
+	lost += missing;
+	index += missing;
+
+	// The transmitter sends a frame every 20ms, so the difference in
+	// transit time between two frames is the jitter (RFC 3550).
+	double transit = (now - start_time) - index * frame_period;
+	if (frames == 0) {
+		min_transit = transit;
+	}
+	else {
+		jitter += (std::abs(transit - last_transit) - jitter) / 16.;
+		min_transit = std::min(min_transit, transit);
+		if (transit - min_transit > late_after) late++;
+	}
+	last_transit = transit;
+
+	index++;
+	frames++;
+}
+
+void quality_meter::decoded(uint8_t errors)
+{
+	bit_errors += errors;
+
+	recent_errors -= recent[recent_pos];
+	recent[recent_pos] = errors;
+	recent_errors += errors;
+	recent_pos = (recent_pos + 1) % window;
+	if (recent_count < window) recent_count++;
+}
+
+void quality_meter::sync_miss()
+{
+	sync_misses++;
+}
+
+static inline uint16_t clamp16(uint32_t v)
+{
+	return std::min<uint32_t>(v, UINT16_MAX);
+}
+
+stream_quality quality_meter::summary() const
+{
+	stream_quality q;
+	q.frames = frames;
+	q.bit_errors = bit_errors;
+	q.ber = recent_count == 0 ? 0 : clamp16(recent_errors * 10000 / (recent_count * bits_per_frame));
+	q.lost = clamp16(lost);
+	q.late = clamp16(late);
+	q.sync_miss = clamp16(sync_misses);
+	q.jitter_us = std::min(jitter * 1e6, (double)UINT32_MAX);
+	return q;
+}
+
+}// namespace dgate
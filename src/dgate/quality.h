@@ -0,0 +1,69 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DGATE_QUALITY_H
+#define DGATE_QUALITY_H
+
+#include "dgate/dgate.h"
+#include <cstdint>
+
+namespace dgate {
+
+// Tracks the link quality of one stream. Every update is O(1), and the
+// struct is plain data so it can live in tx_state (which is memset on
+// reset).
+struct quality_meter {
+	static constexpr int window = 21;          // Frames in the rolling BER
+	static constexpr double frame_period = 0.02;// Seconds per frame
+	static constexpr double late_after = 0.06;  // Three frames
+
+	void start(double now);
+
+	// A voice frame arrived at now, after some frames went missing.
+	void arrival(double now, unsigned missing);
+	// A frame was FEC decoded with this many corrected bits.
+	void decoded(uint8_t bit_errors);
+	void sync_miss();
+
+	stream_quality summary() const;
+
+	uint8_t recent[window];// Bit errors of the last frames
+	int recent_pos;
+	int recent_count;
+	uint32_t recent_errors;
+
+	uint32_t frames;
+	uint32_t bit_errors;
+	uint32_t lost;
+	uint32_t late;
+	uint32_t sync_misses;
+
+	uint32_t index;// Frame slot, counting lost frames
+	double start_time;
+	double min_transit;
+	double last_transit;
+	double jitter;
+};
+
+}// namespace dgate
+
+#endif
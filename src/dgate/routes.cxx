@@ -0,0 +1,115 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "routes.h"
+#include "ircddb/records.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sys/socket.h>
+
+namespace dgate {
+
+route_reader::route_reader(std::shared_ptr<lmdb::env> env, std::shared_ptr<lmdb::dbi> zone_ip4, std::shared_ptr<lmdb::dbi> zone_ip6, std::shared_ptr<lmdb::dbi> irc_sync)
+	: env_(env), zone_ip4_(zone_ip4), zone_ip6_(zone_ip6), irc_sync_(irc_sync), txn_(lmdb::txn::begin(*env_, nullptr, MDB_RDONLY))
+{
+	txn_.reset();
+}
+
+uint8_t route_reader::lookup(dv::callsign cs, route_addr* out)
+{
+	auto zone = cs.upper().base();
+	auto now = std::time(nullptr);
+	ircddb::route_result res;
+
+	txn_.renew();
+	try {
+		// ircddb writes from its own process, so a zone read from an
+		// older snapshot is read again. Rows are only ever added or
+		// replaced, so what is read merges into what is cached.
+		auto id = ::mdb_txn_id(txn_);
+		if (id != policy_in_) load_policy(id);
+		if (read_in_.size() >= max_zones && !read_in_.contains(zone)) {
+			cache_.clear();
+			read_in_.clear();
+		}
+		auto [it, added] = read_in_.try_emplace(zone, id);
+		res = cache_.lookup(zone, now);
+		if (added || it->second != id || res.status == ircddb::route_status::unknown) {
+			load(zone, now);
+			it->second = id;
+			res = cache_.lookup(zone, now);
+		}
+	}
+	catch (const lmdb::error& e) {
+		std::cerr << "dgate: route lookup for " << cs << " failed: " << e.what() << std::endl;
+		res = {};
+	}
+	txn_.reset();
+
+	uint8_t n = std::min(res.count, max_route_addrs);
+	for (uint8_t i = 0; i < n; i++) {
+		const auto& a = res.routes[i];
+		auto& r = out[i];
+		r.server = a.server;
+		r.family = a.af == AF_INET6 ? 6 : 4;
+		r.updated = a.updated;
+		std::memcpy(r.addr, a.addr.data(), sizeof(r.addr));
+	}
+	return n;
+}
+
+// Picks up the policy ircddb last stored. A new policy re-ranks every
+// cached zone, so it is only applied when the stored bytes change.
+void route_reader::load_policy(std::size_t id)
+{
+	std::string_view v;
+	if (!irc_sync_->get(txn_, ircddb::route_policy_key, v)) v = {};
+	policy_in_ = id;
+	if (v == policy_) return;
+
+	auto p = ircddb::route_policy::decode(v);
+	if (!p && !v.empty()) std::cerr << "dgate: ignoring malformed route policy" << std::endl;
+	policy_ = v;
+	cache_.set_policy(p.value_or(ircddb::route_policy{}));
+}
+
+// Reads every route to zone from the tables into the cache, or notes
+// that there are none.
+void route_reader::load(dv::callsign zone, std::time_t now)
+{
+	auto key = ircddb::zone_key::make(zone);
+	bool found = false;
+	for (auto [db, af] : {std::pair{zone_ip6_.get(), AF_INET6}, std::pair{zone_ip4_.get(), AF_INET}}) {
+		auto cur = lmdb::cursor::open(txn_, *db);
+		std::string_view k = lmdb::to_sv(key);
+		for (auto a = cur.get_as<ircddb::gate_addr>(k, MDB_SET_KEY); a; a = cur.get_as<ircddb::gate_addr>(k, MDB_NEXT_DUP)) {
+			cache_.set(zone, af, *a);
+			found = true;
+		}
+	}
+	if (!found) cache_.note_miss(zone, now);
+	cache_.publish();
+}
+
+}// namespace dgate
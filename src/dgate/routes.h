@@ -0,0 +1,78 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DGATE_ROUTES_H
+#define DGATE_ROUTES_H
+
+#include "common/lmdb++.h"
+#include "dgate/dgate.h"
+#include "dv/callsign.h"
+#include "ircddb/route_cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace dgate {
+
+// Answers route queries from the ircDDB tables.
+//
+// One read transaction is kept for the life of the reader. It is renewed
+// for each query and reset afterwards, which keeps its reader slot but
+// releases its snapshot so the writer can reuse pages. The environment
+// must be opened with MDB_NOTLS since the transaction is not tied to the
+// thread that made it.
+//
+// Answers go through an ircddb::route_cache, ranked by the route_policy
+// ircddb stores in irc_sync, which is read again whenever it changes. A zone is read into it on first use and
+// again once ircddb has committed since; in between it is answered from
+// the cache, and unknown zones are remembered as misses for a while.
+class route_reader {
+public:
+	route_reader(std::shared_ptr<lmdb::env> env, std::shared_ptr<lmdb::dbi> zone_ip4, std::shared_ptr<lmdb::dbi> zone_ip6, std::shared_ptr<lmdb::dbi> irc_sync);
+
+	// Fills out with up to max_route_addrs routes to the gateway serving
+	// cs, the policy's choice first. Returns how many.
+	uint8_t lookup(dv::callsign cs, route_addr* out);
+
+private:
+	void load(dv::callsign zone, std::time_t now);
+	void load_policy(std::size_t id);
+
+	std::shared_ptr<lmdb::env> env_;
+	std::shared_ptr<lmdb::dbi> zone_ip4_;
+	std::shared_ptr<lmdb::dbi> zone_ip6_;
+	std::shared_ptr<lmdb::dbi> irc_sync_;
+	lmdb::txn txn_;
+	ircddb::route_cache cache_;
+	// The snapshot each cached zone was read from.
+	std::unordered_map<dv::callsign, std::size_t> read_in_;
+	// The snapshot the policy was last checked in, and what it held.
+	std::size_t policy_in_ = SIZE_MAX;
+	std::string policy_;
+	static constexpr std::size_t max_zones = 1 << 16;
+};
+
+}// namespace dgate
+
+#endif
@@ -20,22 +20,15 @@
 //
 
 #include "app.h"
-#include "common/c++sock.h"
-#include "dgate/dgate.h"
-#include "dlink/xrf.h"
 #include <cerrno>
 #include <cstring>
-#include <fcntl.h>
-#include <fstream>
+#include <csignal>
 #include <iostream>
-#include <netdb.h>
-#include <regex>
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <sys/un.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 namespace dlink {
-static inline constexpr void try_close(int& fd)
+static inline void try_close(int& fd)
 {
 	if (fd != -1) {
 		close(fd);
@@ -43,360 +36,186 @@ static inline constexpr void try_close(int& fd)
 	}
 }
 
-static inline int try_create_socket(const char* port, int family, int* fd)
+static void print_stats(const udp_engine& e)
 {
-	int error;
-	struct addrinfo hints;
-	struct addrinfo* servinfo = nullptr;
-
-	// Listen to v6 socket
-	std::memset(&hints, 0, sizeof(hints));
-	hints.ai_family = family;
-	hints.ai_socktype = SOCK_DGRAM;
-	hints.ai_flags = AI_PASSIVE;
-
-	error = getaddrinfo(nullptr, port, &hints, &servinfo);
-	if (error) {
-		std::cerr << "gai error: " << gai_strerror(error) << std::endl;
-		if (servinfo != nullptr)
-			freeaddrinfo(servinfo);
-		return -1;
-	}
-
-	*fd = socket(servinfo->ai_family, servinfo->ai_socktype, servinfo->ai_protocol);
-	error = errno;
-
-	if (*fd == -1) {
-		std::cerr << "dlink: socket(): could not create socket: ";
-		std::cerr << strerror(error) << std::endl;
-		freeaddrinfo(servinfo);
-		return -1;
-	}
-
-	if (family == AF_INET6) {
-		// do NOT hybrid bind
-		int sockopt = 1;
-		setsockopt(*fd, IPPROTO_IPV6, IPV6_V6ONLY, &sockopt, sizeof(sockopt));
-	}
-
-	error = bind(*fd, servinfo->ai_addr, servinfo->ai_addrlen);
-	if (error) {
-		error = errno;
-		std::cerr << "dlink: bind(): " << strerror(error) << std::endl;
-		freeaddrinfo(servinfo);
-		return -1;
-	}
-	freeaddrinfo(servinfo);
-
-	return 0;
+	auto& st = e.stats();
+	std::cout << e.name() << ": rx " << st.rx_packets << " packets, " << st.rx_bytes << " bytes, " << st.rx_errors << " errors; ";
+	std::cout << "tx " << st.tx_packets << " packets, " << st.tx_bytes << " bytes, " << st.tx_errors << " errors, " << st.tx_dropped << " dropped" << std::endl;
 }
 
-link::link(app* parent_, ev::loop_ref loop_, link_proto p) : parent(parent_), proto(p), status(L_UNLINKED), ev_timeout_(loop_), ev_heartbeat_(loop_)
+link::link(app* parent_, ev::loop_ref loop_, char module)
+	: parent(parent_), proto(L_LOCAL), status(L_UNLINKED), ev_timeout_(loop_), ev_heartbeat_(loop_),
+	  mod_from(module), mod_to(' '), rx_active(false), rx_stream(0), rx_next(0), rx_loss(0.1),
+	  bridge(nullptr), bridge_active(false), bridge_stream(0), tx_count(0)
 {
 	ev_timeout_.set<link, &link::timeout>(this);
 	ev_heartbeat_.set<link, &link::heartbeat>(this);
+
+	ev_timeout_.set(0., link_timing::initial_timeout);
+	ev_heartbeat_.set(0., link_timing::heartbeat_period);
+	timing.reset();
 }
 
 void link::heartbeat(ev::timer&, int)
 {
-	parent->link_heartbeat(proto);
+	parent->link_heartbeat(*this);
 }
 
 void link::timeout(ev::timer&, int)
 {
-	std::cout << "link timeout" << std::endl;
-	parent->unlink(proto);
+	std::cout << "link timeout on module " << mod_from << std::endl;
+	parent->unlink(*this);
 }
 
 void app::do_cleanup()
 {
-	try_close(dcs_sock_v6_);
-	try_close(xrf_sock_v6_);
-	try_close(ref_sock_v6_);
+	xrf_server_.reset();
+
+	ev_hosts_changed_.stop();
+	try_close(hosts_watch_);
 
-	try_close(dcs_sock_v4_);
-	try_close(xrf_sock_v4_);
-	try_close(ref_sock_v4_);
+	ev_metrics_.stop();
+	print_metrics();
+	dcs_.close();
+	xrf_.close();
 }
 
 app::app(const std::string& dgate_socket_path, const std::string& cs, const std::string& reflectors_file, std::unordered_set<char> enabled_mods_)
-	: dgate::client(dgate_socket_path), cs_(cs),
-	  ev_dcs_readable_v6_(loop_), ev_xrf_readable_v6_(loop_), ev_ref_readable_v6_(loop_),
-	  ev_dcs_readable_v4_(loop_), ev_xrf_readable_v4_(loop_), ev_ref_readable_v4_(loop_),
-	  dcs_sock_v6_(-1), xrf_sock_v6_(-1), ref_sock_v6_(-1),
-	  dcs_sock_v4_(-1), xrf_sock_v4_(-1), ref_sock_v4_(-1),
-	  dcs_link_(this, loop_, L_DCS), xrf_link_(this, loop_, L_XRF), ref_link_(this, loop_, L_REF), reflectors_file_(reflectors_file)
+	: dgate::client(dgate_socket_path), cs_(cs), dcs_(loop_, this), xrf_(loop_, this),
+	  reflectors_file_(reflectors_file), hosts_watch_(-1), ev_hosts_changed_(loop_), ev_metrics_(loop_),
+	  rand_gen_(getpid()), rand_dist_()
 {
-	cs_.resize(8, ' ');
-
-	//ev_dcs_readable_v6_.set<app, &app::dcs_readable_v6>(this);
-	ev_xrf_readable_v6_.set<app, &app::xrf_readable_v6>(this);
-	//ev_ref_readable_v6_.set<app, &app::ref_readable_v6>(this);
-
-	//ev_dcs_readable_v4_.set<app, &app::dcs_readable_v4>(this);
-	ev_xrf_readable_v4_.set<app, &app::xrf_readable_v4>(this);
-	//ev_ref_readable_v4_.set<app, &app::ref_readable_v4>(this);
+	ev_hosts_changed_.set<app, &app::hosts_changed>(this);
+	ev_metrics_.set<app, &app::metrics_requested>(this);
 
 	for (char c : enabled_mods_) {
-		modules_[c] = {false, L_LOCAL};
+		links_[c] = std::make_unique<link>(this, loop_, c);
 	}
 }
 
 void app::do_setup()
 {
-	int error;
-
-	std::ifstream hosts;
-	hosts.open(reflectors_file_);
-
-	for (std::string line; std::getline(hosts, line);) {
-		std::istringstream iss(line);
-		std::string host;
-		std::string ip;
-		iss >> host;
-		iss >> ip;
+	hosts_.update(reflectors_file_, reflectors_file_ + ".db");
+	std::cout << std::to_string(hosts_.size()) << " reflectors loaded." << std::endl;
+	watch_hosts();
+	ev_metrics_.start(SIGUSR1);
 
-		host.resize(6, ' '); // TODO: if we want to link to Repeaters we need to check before we truncate
-
-		reflectors_[host] = ip;
+	if (!dcs_.open() || !xrf_.open()) {
+		cleanup();
+		return;
 	}
 
-	std::cout << std::to_string(reflectors_.size()) << " reflectors loaded." << std::endl;
+	if (!xrf_server_mods_.empty()) {
+		xrf_server_ = std::make_unique<xrf_server>(loop_, xrf_server_name_, xrf_server_mods_, xrf_);
+		std::cout << "serving " << xrf_server_name_ << " on " << std::to_string(xrf_server_mods_.size()) << " modules" << std::endl;
+	}
+}
 
-	error = try_create_socket("30001", AF_INET6, &xrf_sock_v6_);
-	if (error) {
-		cleanup();
+// Watch the directory rather than the file, since editors and deploy
+// scripts usually replace the file instead of writing to it.
+void app::watch_hosts()
+{
+	hosts_watch_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (hosts_watch_ == -1) {
+		std::cerr << "dlink: inotify_init1(): " << strerror(errno) << std::endl;
 		return;
 	}
 
-	error = try_create_socket("30001", AF_INET, &xrf_sock_v4_);
-	if (error) {
-		cleanup();
+	auto slash = reflectors_file_.rfind('/');
+	std::string dir = slash == std::string::npos ? "." : reflectors_file_.substr(0, slash + 1);
+	if (inotify_add_watch(hosts_watch_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+		std::cerr << "dlink: inotify_add_watch(): " << strerror(errno) << std::endl;
+		try_close(hosts_watch_);
 		return;
 	}
 
-	fcntl(xrf_sock_v6_, F_SETFL, O_NONBLOCK);
-
-	fcntl(xrf_sock_v4_, F_SETFL, O_NONBLOCK);
+	ev_hosts_changed_.start(hosts_watch_, ev::READ);
+}
 
-	ev_xrf_readable_v6_.start(xrf_sock_v6_, ev::READ);
+void app::hosts_changed(ev::io&, int)
+{
+	auto slash = reflectors_file_.rfind('/');
+	std::string_view name = slash == std::string::npos ? std::string_view(reflectors_file_) : std::string_view(reflectors_file_).substr(slash + 1);
+
+	alignas(inotify_event) char buf[4096];
+	bool changed = false;
+
+	ssize_t len;
+	while ((len = read(hosts_watch_, buf, sizeof(buf))) > 0) {
+		for (char* ptr = buf; ptr < buf + len;) {
+			auto ev = reinterpret_cast<inotify_event*>(ptr);
+			if (ev->len && name == ev->name) changed = true;
+			ptr += sizeof(inotify_event) + ev->len;
+		}
+	}
 
-	ev_xrf_readable_v4_.start(xrf_sock_v4_, ev::READ);
+	if (!changed) return;
 
-	xrf_link_.ev_timeout_.set(0., 5.);  // TODO: how often are heartbeats
-	xrf_link_.ev_heartbeat_.set(0., 1.);// TODO: how often are heartbeats
+	// Links already up keep their address, new links see the new table.
+	if (hosts_.update(reflectors_file_, reflectors_file_ + ".db"))
+		std::cout << std::to_string(hosts_.size()) << " reflectors reloaded." << std::endl;
 }
 
-void app::unlink(link_proto proto)
+bool app::bridge(char a, char b)
 {
-	std::cout << "unlink: ";
-	switch (proto) {
-	case L_DCS: {
-		// TODO
-	} break;
-
-	case L_XRF: {
-		xrf_link_.status = L_UNLINKED;
-		xrf_link_.ev_timeout_.stop();
-		xrf_link_.ev_heartbeat_.stop();
-
-		modules_[xrf_link_.mod_from].link = L_LOCAL;
-
-		xrf_packet p;
-		p.link.mod_from = xrf_link_.mod_from;
-		p.link.mod_to = ' ';
-		p.link.null = 0;
-		std::memcpy(p.link.from, cs_.c_str(), 8);
-		xrf_reply(p, sizeof(xrf_packet_link));
-		std::cout << " xrf.";
-	} break;
-
-	case L_REF: {
-		// TODO
-	} break;
-	case L_LOCAL:
-		break;
-	}
-	std::cout << std::endl;
+	auto la = find_link(a);
+	auto lb = find_link(b);
+	if (la == nullptr || lb == nullptr || la == lb) return false;
+
+	la->bridge = lb;
+	lb->bridge = la;
+	return true;
 }
 
-void app::link_heartbeat(link_proto proto)
+static void print_histogram(const char* name, const uint32_t (&hist)[link_timing::buckets])
 {
-	std::cout << "heartbeat: ";
-	switch (proto) {
-	case L_DCS: {
-		// TODO
-	} break;
-
-	case L_XRF: {
-		xrf_packet p;
-		std::memcpy(p.heartbeat.from, cs_.c_str(), 9);
-		xrf_reply(p, sizeof(xrf_packet_heartbeat));
-		std::cout << " xrf.";
-	} break;
-
-	case L_REF: {
-		// TODO
-	} break;
-	case L_LOCAL:
-		break;
+	std::cout << "  " << name << ":";
+	for (int i = 0; i < link_timing::buckets; i++) {
+		if (hist[i] == 0) continue;
+		std::cout << " " << (i == 0 ? 0 : 1 << i) << "ms:" << hist[i];
 	}
 	std::cout << std::endl;
 }
 
-static const std::regex REFLECTOR_LINK_UR_CS = std::regex("^(DCS|XRF|REF|XLX)([0-9]{3})([A-Z])L$", std::regex_constants::ECMAScript | std::regex_constants::optimize);
-
-void app::dgate_handle_header(const dgate::packet& p, size_t)
+void app::print_metrics()
 {
-	// Ignore non-local packets
-	if (!(p.flags & dgate::P_LOCAL)) return;
-	if (!modules_.contains(p.module)) return;
-
-	auto& h = p.header.h;
-	std::string ur_cs = std::string(h.companion_cs, 8);
-	std::string rpt2 = std::string(h.destination_rptr_cs, 8);
+	print_stats(dcs_);
+	print_stats(xrf_);
 
-	std::smatch match;
+	for (auto& [m, l] : links_) {
+		if (l->status == L_UNLINKED) continue;
 
-	if (modules_[p.module].link == L_LOCAL && std::regex_match(ur_cs, match, REFLECTOR_LINK_UR_CS)) {
-		if (match[1] == "DCS") {
-			// TODO
-		}
-		else if (match[1] == "XRF" || match[1] == "XLX") {
-			std::cout << "XRF link request: " << match[0] << std::endl;
-			xrf_link(p.module, ur_cs.substr(0, 6), ur_cs[6]);
-		}
-		else if (match[1] == "REF") {
-			// TODO
-		}
-	}
-	else if (modules_[p.module].link != L_LOCAL && ur_cs == "       U") {
-		std::cout << "unlink request: " << ur_cs << std::endl;
-		unlink(modules_[p.module].link);
-	}
-	else if (modules_[p.module].link != L_LOCAL && ur_cs == "CQCQCQ  " && rpt2.ends_with('G')) {// Probably just a normal header to send off
-		switch (modules_[p.module].link) {
-		case L_DCS: {
-			// TODO
-		} break;
-
-		case L_XRF: {
-			std::cout << "XRF start TX" << std::endl;
-			xrf_packet xp;
-			std::memcpy(xp.header.title, "DSVT", 4);
-
-			xp.header.config = 0x10U;
-			xp.header.flaga[0] = 0;
-			xp.header.flaga[1] = 0;
-			xp.header.flaga[2] = 0;
-			xp.header.id = 0x20;
-			xp.header.flagb[0] = 0;
-			xp.header.flagb[1] = 1;
-			xp.header.flagb[2] = xrf_link_.mod_to;
-			xp.header.streamid = p.header.id;
-			xp.header.ctrl = 0x80U;
-			xp.header.header = p.header.h;
-
-			std::string ref = xrf_link_.reflector;
-			std::string cs = cs_;
-
-			ref.resize(8, ' ');
-
-			ref[7] = xrf_link_.mod_to;
-			std::memcpy(xp.header.header.destination_rptr_cs, ref.c_str(), 8);
-
-			cs[7] = xrf_link_.mod_from;
-			std::memcpy(xp.header.header.departure_rptr_cs, cs_.c_str(), 8);
-
-			xp.header.header.set_crc(xp.header.header.calc_crc());
-
-			for (int i = 0; i < 5; i++)
-				xrf_reply(xp, sizeof(xrf_packet_header));
-		} break;
-
-		case L_REF: {
-			// TODO
-		} break;
-		case L_LOCAL:
-			break;
-		}
+		auto& t = l->timing;
+		std::cout << "link " << m << " -> " << l->reflector.with_module(l->mod_to) << ": ";
+		std::cout << "rtt " << t.srtt * 1000. << " ms (var " << t.rttvar * 1000. << "), ";
+		std::cout << "heartbeat " << t.interval * 1000. << " ms (jitter " << t.jitter * 1000. << "), ";
+		std::cout << "timeout " << t.timeout() << " s, loss " << l->rx_loss * 100. << "%" << std::endl;
+		print_histogram("rtt", t.rtt_hist);
+		print_histogram("jitter", t.jitter_hist);
 	}
 }
 
-void app::dgate_handle_voice(const dgate::packet& p, size_t)
+void app::metrics_requested(ev::sig&, int)
 {
-	// Ignore non-local packets
-	if (!(p.flags & dgate::P_LOCAL)) return;
-	if (!modules_.contains(p.module)) return;
-	if (modules_[p.module].link == L_LOCAL) return;
-
-	switch (modules_[p.module].link) {
-	case L_DCS: {
-		// TODO
-	} break;
-
-	case L_XRF: {
-		xrf_packet xp;
-		std::memcpy(xp.voice.title, "DSVT", 4);
-		xp.voice.config = 0x20U;
-		xp.voice.flaga[0] = 0;
-		xp.voice.flaga[1] = 0;
-		xp.voice.flaga[2] = 0;
-		xp.voice.id = 0x20;
-		xp.voice.flagb[0] = 0;
-		xp.voice.flagb[0] = 1;
-		xp.voice.flagb[0] = 1;// TODO: does this even matter
-		xp.voice.streamid = p.voice.id;
-		xp.voice.seqno = p.voice.seqno;
-		xp.voice.frame = p.voice.f;
-		xrf_reply(xp, sizeof(xrf_packet_voice));
-		std::cout << "XRF voice send" << std::endl;
-	} break;
-
-	case L_REF: {
-		// TODO
-	} break;
-	case L_LOCAL:
-		break;
-	}
+	print_metrics();
 }
 
-void app::dgate_handle_voice_end(const dgate::packet& p, size_t)
+void app::set_repeat_slot(double seconds)
 {
-	// Ignore non-local packets
-	if (!(p.flags & dgate::P_LOCAL)) return;
-	if (!modules_.contains(p.module)) return;
-	if (modules_[p.module].link == L_LOCAL) return;
-
-	switch (modules_[p.module].link) {
-	case L_DCS: {
-		// TODO
-	} break;
-
-	case L_XRF: {
-		xrf_packet xp;
-		std::memcpy(xp.voice.title, "DSVT", 4);
-		xp.voice.config = 0x20U;
-		xp.voice.flaga[0] = 0;
-		xp.voice.flaga[1] = 0;
-		xp.voice.flaga[2] = 0;
-		xp.voice.id = 0x20;
-		xp.voice.flagb[0] = 0;
-		xp.voice.flagb[0] = 1;
-		xp.voice.flagb[0] = 1;// TODO: does this even matter
-		xp.voice.streamid = p.voice_end.id;
-		xp.voice.seqno = 0x40U | p.voice_end.seqno;
-		xp.voice.frame = p.voice_end.f;
-		xrf_reply(xp, sizeof(xrf_packet_voice));
-		std::cout << "XRF voice end" << std::endl;
-	} break;
-
-	case L_REF: {
-		// TODO
-	} break;
-	case L_LOCAL:
-		break;
-	}
+	dcs_.set_slot(seconds);
+	xrf_.set_slot(seconds);
+}
+
+void app::serve_xrf(dv::callsign name, std::unordered_set<char> modules)
+{
+	xrf_server_name_ = name;
+	xrf_server_mods_ = std::move(modules);
+}
+
+link* app::find_link(char module)
+{
+	auto it = links_.find(module);
+	return it == links_.end() ? nullptr : it->second.get();
 }
 
 }// namespace dlink
@@ -22,22 +22,24 @@
 #ifndef DLINK_APP_H
 #define DLINK_APP_H
 
+#include "common/c++sock.h"
 #include "dgate/client.h"
+#include "dlink/dcs.h"
+#include "dlink/engine.h"
+#include "dlink/hosts.h"
+#include "dlink/proto.h"
+#include "dlink/timing.h"
 #include "dv/types.h"
 #include "xrf.h"
+#include "xrf_server.h"
 #include <ev++.h>
+#include <memory>
+#include <random>
 #include <sys/socket.h>
 #include <unordered_map>
 #include <unordered_set>
 namespace dlink {
 
-enum link_proto {
-	L_LOCAL,
-	L_DCS,
-	L_XRF,
-	L_REF,
-};
-
 enum link_status {
 	L_UNLINKED,
 	L_CONNECTING,
@@ -46,13 +48,9 @@ enum link_status {
 
 class app;
 
-struct module_state {
-	bool tx_lock;
-	link_proto link;
-};
-
+// One per local module. Each module links (or doesn't) independently.
 struct link {
-	link(app* parent, ev::loop_ref loop, link_proto proto);
+	link(app* parent, ev::loop_ref loop, char module);
 
 	app* parent;
 
@@ -65,19 +63,60 @@ struct link {
 	ev::timer ev_timeout_;
 	ev::timer ev_heartbeat_;
 
-	std::string reflector;
-	char mod_from;
+	dv::callsign reflector;
+	char mod_from;// Local module
 	char mod_to;
 
 	sockaddr_storage addr;
+	peer_key peer;
+
+	// Stream currently coming in from the reflector.
+	bool rx_active;
+	uint16_t rx_stream;
+	uint8_t rx_next;// Expected seqno
+	double rx_loss; // Moving average of the voice frames lost
+
+	link_timing timing;
+
+	// Another of our links that streams are repeated to, and the id the
+	// current stream has there.
+	link* bridge;
+	bool bridge_active;
+	uint16_t bridge_stream;
+
+	// Header of the stream going out to the reflector, for protocols
+	// that repeat it in every voice packet.
+	dv::header tx_header;
+	uint32_t tx_count;
 };
 
 class app : public dgate::client {
 	friend link;
 
 public:
+	template <typename P>
+	using engine = link_engine<P, app>;
+
 	app(const std::string& dgate_socket_path, const std::string& cs, const std::string& reflectors_file, std::unordered_set<char> enabled_mods_);
 
+	// Also act as an XRF reflector for these modules. Call before setup().
+	void serve_xrf(dv::callsign name, std::unordered_set<char> modules);
+
+	// Repeat streams received on either module's link to the other's,
+	// without going through dgate.
+	bool bridge(char a, char b);
+
+	// Time between the copies of a header or link request.
+	void set_repeat_slot(double seconds);
+
+	// Engine counters and per link timing, loss and timeouts. Also
+	// printed on SIGUSR1.
+	void print_metrics();
+
+	// Called by the engines for every datagram.
+	template <typename P>
+	void on_packet(engine<P>& e, typename P::packet& p, size_t len, const sockaddr_storage& from);
+
 protected:
 	void do_setup() override;
 	void do_cleanup() override;
@@ -87,46 +126,61 @@ protected:
 	void dgate_handle_voice_end(const dgate::packet& p, size_t len) override;
 
 private:
-	void unlink(link_proto proto);
-	void link_heartbeat(link_proto proto);
-
-	void xrf_reply(const xrf_packet& p, size_t len);
-	void xrf_link(char mod_from, const std::string& ref, char mod_to);
-	void xrf_handle_packet(const xrf_packet& p, size_t len, const sockaddr_storage& from);
-	void xrf_handle_header(const xrf_packet& p, size_t len, const sockaddr_storage& from);
-	void xrf_handle_voice(const xrf_packet& p, size_t len, const sockaddr_storage& from);
-
-	std::string cs_;
-
-	void dcs_readable_v6(ev::io&, int);
-	void xrf_readable_v6(ev::io&, int);
-	void ref_readable_v6(ev::io&, int);
-	ev::io ev_dcs_readable_v6_;
-	ev::io ev_xrf_readable_v6_;
-	ev::io ev_ref_readable_v6_;
-
-	void dcs_readable_v4(ev::io&, int);
-	void xrf_readable_v4(ev::io&, int);
-	void ref_readable_v4(ev::io&, int);
-	ev::io ev_dcs_readable_v4_;
-	ev::io ev_xrf_readable_v4_;
-	ev::io ev_ref_readable_v4_;
-
-	int dcs_sock_v6_;
-	int xrf_sock_v6_;
-	int ref_sock_v6_;
-
-	int dcs_sock_v4_;
-	int xrf_sock_v4_;
-	int ref_sock_v4_;
-
-	link dcs_link_;
-	link xrf_link_;
-	link ref_link_;
+	// Calls f with the engine for proto. This is the only place that
+	// switches on the protocol; everything f does is specialized.
+	template <typename F>
+	void with_engine(link_proto proto, F&& f);
+
+	link* find_link(char module);
+	void unlink(link& l);
+	void link_heartbeat(link& l);
+
+	template <typename P>
+	void link_to(engine<P>& e, link& l, dv::callsign ref, char mod_to);
+	template <typename P>
+	void set_peer(engine<P>& e, link& l, const sockaddr_storage* addr);
+	template <typename P>
+	void rx_start(engine<P>& e, link& l, uint16_t id);
+	template <typename P>
+	void rx_end(engine<P>& e, link& l);
+
+	template <typename P>
+	bool recover_header(engine<P>& e, typename P::packet& p, const peer_key& key, typename P::packet& out);
+	template <typename P>
+	void handle_header(engine<P>& e, link& l, typename P::packet& p);
+	template <typename P>
+	void handle_voice(engine<P>& e, link& l, typename P::packet& p);
+
+	template <typename P>
+	void bridge_header(link& l, typename P::packet& p);
+	template <typename P>
+	void bridge_voice(link& l, typename P::packet& p);
+
+	void watch_hosts();
+	void hosts_changed(ev::io&, int);
+	void metrics_requested(ev::sig&, int);
+
+	dv::callsign cs_;
+
+	engine<dcs_traits> dcs_;
+	engine<xrf_traits> xrf_;
 
 	std::string reflectors_file_;
-	std::unordered_map<std::string, std::string> reflectors_;
-	std::unordered_map<char, module_state> modules_;
+	host_db hosts_;
+	int hosts_watch_;
+	ev::io ev_hosts_changed_;
+
+	// Keyed by local module.
+	std::unordered_map<char, std::unique_ptr<link>> links_;
+
+	dv::callsign xrf_server_name_;
+	std::unordered_set<char> xrf_server_mods_;
+	std::unique_ptr<xrf_server> xrf_server_;
+
+	ev::sig ev_metrics_;
+
+	std::minstd_rand rand_gen_;
+	std::uniform_int_distribution<uint16_t> rand_dist_;
 };
 
 };// namespace dlink
@@ -0,0 +1,560 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "app.h"
+#include "common/c++sock.h"
+#include "dgate/dgate.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <regex>
+#include <sys/socket.h>
+#include <type_traits>
+
+// Everything here is written once against the protocol traits (see
+// xrf_traits) and specialized per engine by the compiler.
+
+namespace dlink {
+
+template <typename E>
+using traits_of = typename std::remove_reference_t<E>::traits;
+
+static dv::header retarget(dv::header h, dv::callsign rpt1, dv::callsign rpt2)
+{
+	rpt2.to_field(h.destination_rptr_cs);
+	rpt1.to_field(h.departure_rptr_cs);
+	h.set_crc(h.calc_crc());
+	return h;
+}
+
+// DCS reflectors put themselves in either RPT field.
+static bool addressed_to(const dv::header& h, dv::callsign reflector)
+{
+	return h.destination_rptr() == reflector || h.departure_rptr() == reflector;
+}
+
+// Headers and link requests are sent more than once since UDP drops
+// them. How many copies depends on the loss seen on the link: enough
+// that all of them get lost for fewer than one stream in a thousand.
+static constexpr int min_copies = 2;
+static constexpr int max_copies = 5;
+static constexpr double residual_loss = 1e-3;
+static constexpr double loss_alpha = 1. / 64.;
+
+static int header_copies(const link& l)
+{
+	if (l.rx_loss <= 0.) return min_copies;
+	int n = std::ceil(std::log(residual_loss) / std::log(l.rx_loss));
+	return std::clamp(n, min_copies, max_copies);
+}
+
+// Only inbound loss can be seen, which stands in for the whole path.
+static void measure_loss(link& l, uint8_t seqno)
+{
+	auto gap = dgate::seqno_gap(l.rx_next, seqno);
+	if (gap > 10) return;// Late or repeated
+
+	l.rx_next = (seqno + 1) % 21;
+	for (; gap > 0; gap--)
+		l.rx_loss += loss_alpha * (1. - l.rx_loss);
+	l.rx_loss -= loss_alpha * l.rx_loss;
+}
+
+template <typename F>
+void app::with_engine(link_proto proto, F&& f)
+{
+	switch (proto) {
+	case L_DCS:
+		f(dcs_);
+		break;
+
+	case L_XRF:
+		f(xrf_);
+		break;
+
+	case L_REF:
+		// TODO
+	case L_LOCAL:
+		break;
+	}
+}
+
+// Moves the link to a new reflector address, or removes it from the
+// engine's address table if addr is null.
+template <typename P>
+void app::set_peer(engine<P>& e, link& l, const sockaddr_storage* addr)
+{
+	if (l.proto == P::proto) {
+		if (auto links = e.peers.find(l.peer)) {
+			std::erase(*links, &l);
+			if (links->empty()) {
+				e.peers.erase(l.peer);
+				e.cancel_repeats(l.peer);
+			}
+		}
+	}
+
+	if (addr == nullptr) return;
+
+	l.addr = *addr;
+	l.peer = peer_key(*addr);
+	e.peers[l.peer].push_back(&l);
+}
+
+template <typename P>
+void app::link_to(engine<P>& e, link& l, dv::callsign ref, char mod_to)
+{
+	auto host = hosts_.find(ref);
+	if (host == nullptr) {
+		std::cerr << P::name << " link: unknown reflector " << ref << std::endl;
+		return;
+	}
+
+	typename P::packet p;
+	auto len = P::link(p, cs_, l.mod_from, mod_to, ref.with_module(mod_to));
+
+	auto addr = host->sockaddr(P::port);
+	set_peer(e, l, &addr);
+
+	l.proto = P::proto;
+	l.status = L_CONNECTING;
+	l.reflector = ref;
+	l.mod_to = mod_to;
+
+	l.timing.reset();
+	l.timing.request(loop_.now());
+	l.ev_timeout_.repeat = link_timing::initial_timeout;
+	l.ev_timeout_.again();
+
+	// Nothing is known about the path yet, so send the most copies.
+	e.send_repeated(l.addr, &p, len, max_copies);
+}
+
+template <typename P>
+void app::rx_start(engine<P>& e, link& l, uint16_t id)
+{
+	rx_end(e, l);
+	l.rx_active = true;
+	l.rx_stream = id;
+	e.streams[id] = &l;
+	e.late.erase(id);
+	l.rx_next = 0;
+}
+
+template <typename P>
+void app::rx_end(engine<P>& e, link& l)
+{
+	l.bridge_active = false;
+	if (!l.rx_active) return;
+
+	auto it = e.streams.find(l.rx_stream);
+	if (it != e.streams.end() && it->second == &l) e.streams.erase(it);
+	l.rx_active = false;
+}
+
+void app::unlink(link& l)
+{
+	std::cout << "unlink " << l.mod_from << ": ";
+
+	with_engine(l.proto, [&](auto& e) {
+		using P = traits_of<decltype(e)>;
+		typename P::packet p;
+		e.cancel_repeats(l.peer);
+		e.send(l.addr, &p, P::unlink(p, cs_, l.mod_from, l.reflector.with_module(l.mod_to)));
+		set_peer(e, l, nullptr);
+		rx_end(e, l);
+		std::cout << " " << P::name << ".";
+	});
+
+	l.proto = L_LOCAL;
+	l.status = L_UNLINKED;
+	l.ev_timeout_.stop();
+	l.ev_heartbeat_.stop();
+	l.bridge_active = false;
+	std::cout << std::endl;
+}
+
+void app::link_heartbeat(link& l)
+{
+	std::cout << "heartbeat " << l.mod_from << ": ";
+	with_engine(l.proto, [&](auto& e) {
+		using P = traits_of<decltype(e)>;
+		typename P::packet p;
+		e.send(l.addr, &p, P::heartbeat(p, cs_, l.mod_from, l.reflector.with_module(l.mod_to)));
+		std::cout << " " << P::name << ".";
+	});
+	std::cout << std::endl;
+}
+
+template <typename P>
+void app::on_packet(engine<P>& e, typename P::packet& p, size_t len, const sockaddr_storage& from)
+{
+	if constexpr (P::proto == L_XRF) {
+		if (xrf_server_ && xrf_server_->handle_packet(p, len, from)) return;
+	}
+
+	auto kind = P::classify(p, len);
+	if (kind == K_UNKNOWN) return;
+
+	peer_key key(from);
+
+	// The packet that starts a new stream.
+	typename P::packet synth;
+	typename P::packet* hp = &p;
+
+	// Streams we are already playing are the common case.
+	if (kind == K_VOICE) {
+		auto it = e.streams.find(P::stream_id(p, kind));
+		if (it != e.streams.end()) {
+			auto& l = *it->second;
+			if (l.peer != key) return;
+
+			l.ev_timeout_.again();
+			handle_voice(e, l, p);
+			return;
+		}
+
+		// If every voice packet carries the header, a stream we haven't
+		// seen yet can be joined from any packet, not just the first.
+		// Otherwise it can be once the header has come around in the
+		// slow data.
+		if constexpr (P::voice_has_header) {
+			if (P::is_end(p)) return;
+		}
+		else {
+			if (!recover_header(e, p, key, synth)) return;
+			hp = &synth;
+		}
+	}
+
+	// Acks echo our module back to us.
+	if (kind == K_ACK || kind == K_NAK) {
+		auto l = find_link(P::ack_module(p));
+		if (l == nullptr || l->proto != P::proto || l->status != L_CONNECTING) return;
+		if (l->peer != key) return;
+
+		if (kind == K_NAK) {
+			std::cout << P::name << " link failed on module " << l->mod_from << std::endl;
+			// TODO: message
+			unlink(*l);
+			return;
+		}
+		l->timing.ack(loop_.now());
+		std::cout << P::name << " link success on module " << l->mod_from << ", rtt " << l->timing.srtt * 1000. << " ms" << std::endl;
+		l->ev_timeout_.again();
+		l->ev_heartbeat_.again();
+		l->status = L_LINKED;
+		return;
+	}
+
+	// Headers are repeated, only the first one starts the stream.
+	if (kind == K_HEADER) {
+		auto it = e.streams.find(P::stream_id(p, kind));
+		if (it != e.streams.end() && it->second->peer == key) {
+			auto& l = *it->second;
+			l.ev_timeout_.again();
+			return;
+		}
+	}
+
+	// Heartbeats and new streams don't say which of our modules they are
+	// for, so check every link to this reflector. A stream goes to an
+	// idle link if there is one, otherwise it replaces a stream that
+	// never ended.
+	auto links = e.peers.find(key);
+	if (links == nullptr) return;
+
+	dv::header h;
+	if (kind != K_HEARTBEAT) h = P::get_header(*hp);
+
+	auto start = [&](link& l) {
+		l.ev_timeout_.again();
+		handle_header(e, l, *hp);
+		if (kind == K_VOICE) {
+			l.rx_next = P::seqno(p);
+			handle_voice(e, l, p);
+		}
+	};
+
+	link* busy = nullptr;
+	for (auto l : *links) {
+		if (l->status != L_LINKED) continue;
+
+		if (kind == K_HEARTBEAT) {
+			l->timing.heard(loop_.now());
+			l->ev_timeout_.repeat = l->timing.timeout();
+			l->ev_timeout_.again();
+		}
+		else if (addressed_to(h, l->reflector.with_module(l->mod_to))) {
+			if (l->rx_active) {
+				if (busy == nullptr) busy = l;
+				continue;
+			}
+			start(*l);
+			return;
+		}
+	}
+
+	if (busy != nullptr) start(*busy);
+}
+
+static constexpr size_t max_late_streams = 16;
+
+// Rebuilds the header packet of a stream whose header was lost from
+// its slow data, so it can be started like any other.
+template <typename P>
+bool app::recover_header(engine<P>& e, typename P::packet& p, const peer_key& key, typename P::packet& out)
+{
+	auto id = P::stream_id(p, K_VOICE);
+	if (P::is_end(p)) {
+		e.late.erase(id);
+		return false;
+	}
+
+	auto it = e.late.find(id);
+	if (it == e.late.end()) {
+		// Only for reflectors we are linked to, and streams that never
+		// end mustn't pile up.
+		if (!e.peers.contains(key)) return false;
+		if (e.late.size() >= max_late_streams) e.late.clear();
+		it = e.late.emplace(id, late_stream{key, {}}).first;
+	}
+	else if (it->second.peer != key) {
+		return false;
+	}
+
+	dv::header h;
+	if (!it->second.decoder.add(P::seqno(p), P::frame(p), h)) return false;
+
+	e.late.erase(it);
+	std::cout << P::name << " recovered header of stream " << id << " from slow data" << std::endl;
+	P::header(out, h, id, h.departure_rptr(), h.destination_rptr());
+	return true;
+}
+
+template <typename P>
+void app::handle_header(engine<P>& e, link& l, typename P::packet& p)
+{
+	dgate::packet dp;
+	auto id = P::stream_id(p, K_HEADER);
+
+	rx_start(e, l, id);
+
+	dp.module = l.mod_from;
+	dp.type = dgate::P_HEADER;
+	dp.header.h = P::get_header(p);
+	dp.header.id = id;
+
+	// RPT1: RPTR   A
+	// RTP2: RPTR   G
+	cs_.with_module(dp.module).to_field(dp.header.h.departure_rptr_cs);
+	cs_.with_module('G').to_field(dp.header.h.destination_rptr_cs);
+
+	dp.header.h.set_crc(dp.header.h.calc_crc());
+
+	// TODO: does URCALL need to be overwritten too?
+
+	send(dgate_sock_, &dp, dgate::packet_header_size, 0);
+
+	if (l.bridge) bridge_header<P>(l, p);
+}
+
+template <typename P>
+void app::handle_voice(engine<P>& e, link& l, typename P::packet& p)
+{
+	dgate::packet dp;
+	auto id = P::stream_id(p, K_VOICE);
+	bool end = P::is_end(p);
+
+	measure_loss(l, P::seqno(p));
+
+	dp.module = l.mod_from;
+	if (end) {
+		dp.type = dgate::P_VOICE_END;
+		dp.voice_end.bit_errors = 0;
+		dp.voice_end.quality = {};
+		dp.voice_end.count = 0;
+		dp.voice_end.f = P::frame(p);
+		dp.voice_end.id = id;
+		dp.voice_end.seqno = P::seqno(p);
+	}
+	else {
+		dp.type = dgate::P_VOICE;
+		dp.voice.count = 0;
+		dp.voice.seqno = P::seqno(p);
+		dp.voice.f = P::frame(p);
+		dp.voice.id = id;
+	}
+
+	send(dgate_sock_, &dp, end ? dgate::packet_voice_end_size : dgate::packet_voice_size, 0);
+
+	if (l.bridge) bridge_voice<P>(l, p);
+	if (end) rx_end(e, l);
+}
+
+// Between links of the same protocol the packet is rewritten in place
+// and sent as is, otherwise it is rebuilt in the other protocol. The
+// copies of the header we got are not passed on; the other link sends
+// as many as its own loss calls for.
+template <typename From>
+void app::bridge_header(link& l, typename From::packet& p)
+{
+	auto& to = *l.bridge;
+	if (to.status != L_LINKED) return;
+
+	l.bridge_active = true;
+	l.bridge_stream = rand_dist_(rand_gen_);
+
+	auto rpt1 = cs_.with_module(to.mod_from);
+	auto rpt2 = to.reflector.with_module(to.mod_to);
+
+	to.tx_header = retarget(From::get_header(p), rpt1, rpt2);
+	to.tx_count = 0;
+
+	bool sent = false;
+	with_engine(to.proto, [&](auto& e) {
+		using To = traits_of<decltype(e)>;
+		if constexpr (!To::header_packets) {
+			// Goes out with the voice packets.
+		}
+		else if constexpr (std::is_same_v<To, From>) {
+			e.send_repeated(to.addr, &p, To::retarget_header(p, l.bridge_stream, rpt1, rpt2), header_copies(to));
+		}
+		else {
+			typename To::packet out;
+			e.send_repeated(to.addr, &out, To::header(out, to.tx_header, l.bridge_stream, rpt1, rpt2), header_copies(to));
+		}
+		sent = true;
+	});
+
+	if (!sent) l.bridge_active = false;
+}
+
+template <typename From>
+void app::bridge_voice(link& l, typename From::packet& p)
+{
+	if (!l.bridge_active) return;
+
+	auto& to = *l.bridge;
+	if (to.status != L_LINKED) return;
+
+	with_engine(to.proto, [&](auto& e) {
+		using To = traits_of<decltype(e)>;
+		if constexpr (std::is_same_v<To, From>) {
+			e.send(to.addr, &p, To::retarget_voice(p, to.tx_header, l.bridge_stream));
+		}
+		else {
+			typename To::packet out;
+			e.send(to.addr, &out, To::voice(out, to.tx_header, l.bridge_stream, From::seqno(p), From::is_end(p), From::frame(p), to.tx_count));
+		}
+	});
+	to.tx_count++;
+}
+
+template void app::on_packet<dcs_traits>(engine<dcs_traits>&, dcs_packet&, size_t, const sockaddr_storage&);
+template void app::on_packet<xrf_traits>(engine<xrf_traits>&, xrf_packet&, size_t, const sockaddr_storage&);
+
+static constexpr dv::callsign UR_UNLINK = "       U";
+static constexpr dv::callsign UR_CQCQCQ = "CQCQCQ  ";
+
+static const std::regex REFLECTOR_LINK_UR_CS = std::regex("^(DCS|XRF|REF|XLX)([0-9]{3})([A-Z])L$", std::regex_constants::ECMAScript | std::regex_constants::optimize);
+
+void app::dgate_handle_header(const dgate::packet& p, size_t)
+{
+	// Ignore non-local packets
+	if (!(p.flags & dgate::P_LOCAL)) return;
+	auto l = find_link(p.module);
+	if (l == nullptr) return;
+
+	auto& h = p.header.h;
+	auto ur = h.companion();
+	auto rpt2 = h.destination_rptr();
+
+	std::smatch match;
+	std::string ur_cs;
+
+	// Only link commands need the regex, and they always end in L.
+	if (l->proto == L_LOCAL && ur.module() == 'L' && std::regex_match(ur_cs = ur.str(), match, REFLECTOR_LINK_UR_CS)) {
+		if (match[1] == "DCS") {
+			std::cout << "DCS link request: " << match[0] << std::endl;
+			link_to(dcs_, *l, ur.truncate(6), ur[6]);
+		}
+		else if (match[1] == "XRF" || match[1] == "XLX") {
+			std::cout << "XRF link request: " << match[0] << std::endl;
+			link_to(xrf_, *l, ur.truncate(6), ur[6]);
+		}
+		else if (match[1] == "REF") {
+			// TODO
+		}
+	}
+	else if (l->proto != L_LOCAL && ur == UR_UNLINK) {
+		std::cout << "unlink request: " << ur << std::endl;
+		unlink(*l);
+	}
+	else if (l->status == L_LINKED && ur == UR_CQCQCQ && rpt2.module() == 'G') {// Probably just a normal header to send off
+		auto rpt1 = cs_.with_module(l->mod_from);
+		auto rpt2 = l->reflector.with_module(l->mod_to);
+		l->tx_header = retarget(h, rpt1, rpt2);
+		l->tx_count = 0;
+
+		with_engine(l->proto, [&](auto& e) {
+			using P = traits_of<decltype(e)>;
+			std::cout << P::name << " start TX" << std::endl;
+
+			if constexpr (P::header_packets) {
+				typename P::packet xp;
+				auto len = P::header(xp, l->tx_header, p.header.id, rpt1, rpt2);
+				e.send_repeated(l->addr, &xp, len, header_copies(*l));
+			}
+		});
+	}
+}
+
+void app::dgate_handle_voice(const dgate::packet& p, size_t)
+{
+	// Ignore non-local packets
+	if (!(p.flags & dgate::P_LOCAL)) return;
+	auto l = find_link(p.module);
+	if (l == nullptr || l->status != L_LINKED) return;
+
+	with_engine(l->proto, [&](auto& e) {
+		using P = traits_of<decltype(e)>;
+		typename P::packet xp;
+		e.send(l->addr, &xp, P::voice(xp, l->tx_header, p.voice.id, p.voice.seqno, false, p.voice.f, l->tx_count++));
+	});
+}
+
+void app::dgate_handle_voice_end(const dgate::packet& p, size_t)
+{
+	// Ignore non-local packets
+	if (!(p.flags & dgate::P_LOCAL)) return;
+	auto l = find_link(p.module);
+	if (l == nullptr || l->status != L_LINKED) return;
+
+	with_engine(l->proto, [&](auto& e) {
+		using P = traits_of<decltype(e)>;
+		typename P::packet xp;
+		e.send(l->addr, &xp, P::voice(xp, l->tx_header, p.voice_end.id, p.voice_end.seqno, true, p.voice_end.f, l->tx_count++));
+		std::cout << P::name << " voice end" << std::endl;
+	});
+}
+}// namespace dlink
@@ -35,8 +35,11 @@
 #ifndef DGATE_DCS_H
 #define DGATE_DCS_H
 
+#include "dlink/proto.h"
+#include "dv/types.h"
 #include <cstdint>
-namespace dgate {
+#include <cstring>
+namespace dlink {
 
 #pragma pack(push, 1)
 struct dcs_packet_heartbeat {
@@ -54,9 +57,170 @@ struct dcs_packet_unlink {
 };
 
 struct dcs_packet_link {
+	char from[8];// Includes module
+	char mod_from;
+	char mod_to;
+	char null;
+	char to[8];
+	char info[500];// HTML shown on the reflector's dashboard
+};
+
+struct dcs_packet_link_ack {
+	char from[8];
+	char mod_from;
+	char mod_to;
+	char ack[3];// Could also be NAK if failed to connect
+	char null;
+};
+
+// DCS has no header packet, every voice packet carries the header.
+struct dcs_packet_voice {
+	char title[4];           //  0   "0001"
+	uint8_t header[39];      //  4   dv::header without the crc
+	uint16_t streamid;       // 43
+	uint8_t seqno;           // 45   framecounter (mod 21), 0x40 on the last
+	dv::rf_frame frame;      // 46
+	uint8_t count[3];        // 58   packets in the stream, little-endian
+	uint8_t unknown[3];      // 61   0x01 0x00 0x21
+	char text[20];           // 64   slow data message
+	uint8_t pad[16];         // 84   total 100
+};
+
+struct dcs_packet {
+	union {
+		dcs_packet_voice voice;
+		dcs_packet_heartbeat heartbeat;
+		dcs_packet_link link;
+		dcs_packet_unlink unlink;
+		dcs_packet_link_ack ack;
+	};
+
+	inline bool is_ack() const
+	{
+		return ack.null == 0 && ack.ack[2] == 'K';
+	}
+
+	inline bool is_voice() const
+	{
+		return std::memcmp(voice.title, "0001", 4) == 0;
+	}
 };
 #pragma pack(pop)
 
-}// namespace dgate
+// Everything the link engine needs to know about DCS.
+struct dcs_traits {
+	using packet = dcs_packet;
+
+	static constexpr link_proto proto = L_DCS;
+	static constexpr const char* name = "dcs";
+	static constexpr uint16_t port = 30051;
+
+	// No header packets: streams start with their first voice packet, so
+	// a late joiner gets the header from whichever packet comes next.
+	static constexpr bool header_packets = false;
+	static constexpr bool voice_has_header = true;
+
+	static inline packet_kind classify(const packet& p, size_t len)
+	{
+		switch (len) {
+		case sizeof(dcs_packet_heartbeat):
+			return K_HEARTBEAT;
+		case sizeof(dcs_packet_link_ack):
+			if (!p.is_ack()) return K_UNKNOWN;
+			return p.ack.ack[0] == 'N' ? K_NAK : K_ACK;
+		case sizeof(dcs_packet_voice):
+			return p.is_voice() ? K_VOICE : K_UNKNOWN;
+		}
+		return K_UNKNOWN;
+	}
+
+	static inline size_t link(packet& p, dv::callsign cs, char mod_from, char mod_to, dv::callsign reflector)
+	{
+		std::memset(&p.link, 0, sizeof(dcs_packet_link));
+		cs.with_module(mod_from).to_field(p.link.from);
+		p.link.mod_from = mod_from;
+		p.link.mod_to = mod_to;
+		reflector.to_field(p.link.to);
+		std::strcpy(p.link.info, "<table><tr><td>dgate</td></tr></table>");
+		return sizeof(dcs_packet_link);
+	}
+
+	static inline size_t unlink(packet& p, dv::callsign cs, char mod_from, dv::callsign reflector)
+	{
+		cs.with_module(mod_from).to_field(p.unlink.from);
+		p.unlink.from_mod = mod_from;
+		p.unlink.space = ' ';
+		p.unlink.null = 0;
+		reflector.to_field(p.unlink.to);
+		return sizeof(dcs_packet_unlink);
+	}
+
+	static inline size_t heartbeat(packet& p, dv::callsign cs, char mod_from, dv::callsign reflector)
+	{
+		cs.with_module(mod_from).to_field(p.heartbeat.from);
+		p.heartbeat.unknown = 0;
+		reflector.to_field(p.heartbeat.to);
+		return sizeof(dcs_packet_heartbeat);
+	}
+
+	// h is the header as it should appear on the reflector.
+	static inline size_t voice(packet& p, const dv::header& h, uint16_t id, uint8_t seqno, bool end, const dv::rf_frame& f, uint32_t count)
+	{
+		std::memcpy(p.voice.title, "0001", 4);
+		p.voice.seqno = end ? 0x40U | seqno : seqno;
+		p.voice.frame = f;
+		p.voice.count[0] = count;
+		p.voice.count[1] = count >> 8;
+		p.voice.count[2] = count >> 16;
+		p.voice.unknown[0] = 0x01;
+		p.voice.unknown[1] = 0x00;
+		p.voice.unknown[2] = 0x21;
+		std::memset(p.voice.text, ' ', sizeof(p.voice.text));
+		std::memset(p.voice.pad, 0, sizeof(p.voice.pad));
+		return retarget_voice(p, h, id);
+	}
+
+	static inline size_t retarget_voice(packet& p, const dv::header& h, uint16_t id)
+	{
+		std::memcpy(p.voice.header, &h, sizeof(p.voice.header));
+		p.voice.streamid = id;
+		return sizeof(dcs_packet_voice);
+	}
+
+	static inline uint16_t stream_id(const packet& p, packet_kind)
+	{
+		return p.voice.streamid;
+	}
+
+	static inline dv::header get_header(const packet& p)
+	{
+		dv::header h;
+		std::memcpy(&h, p.voice.header, sizeof(p.voice.header));
+		h.set_crc(h.calc_crc());
+		return h;
+	}
+
+	static inline uint8_t seqno(const packet& p)
+	{
+		return p.voice.seqno & 0x1FU;
+	}
+
+	static inline bool is_end(const packet& p)
+	{
+		return p.voice.seqno & 0x40U;
+	}
+
+	static inline const dv::rf_frame& frame(const packet& p)
+	{
+		return p.voice.frame;
+	}
+
+	static inline char ack_module(const packet& p)
+	{
+		return p.ack.mod_from;
+	}
+};
+
+}// namespace dlink
 
 #endif
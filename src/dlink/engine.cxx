@@ -0,0 +1,301 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "engine.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <string>
+#include <unistd.h>
+
+namespace dlink {
+
+static inline void try_close(int& fd)
+{
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+}
+
+static inline int try_create_socket(const char* port, int family, int* fd)
+{
+	int error;
+	struct addrinfo hints;
+	struct addrinfo* servinfo = nullptr;
+
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_PASSIVE;
+
+	error = getaddrinfo(nullptr, port, &hints, &servinfo);
+	if (error) {
+		std::cerr << "gai error: " << gai_strerror(error) << std::endl;
+		if (servinfo != nullptr)
+			freeaddrinfo(servinfo);
+		return -1;
+	}
+
+	*fd = socket(servinfo->ai_family, servinfo->ai_socktype, servinfo->ai_protocol);
+	error = errno;
+
+	if (*fd == -1) {
+		std::cerr << "dlink: socket(): could not create socket: ";
+		std::cerr << strerror(error) << std::endl;
+		freeaddrinfo(servinfo);
+		return -1;
+	}
+
+	if (family == AF_INET6) {
+		// do NOT hybrid bind
+		int sockopt = 1;
+		setsockopt(*fd, IPPROTO_IPV6, IPV6_V6ONLY, &sockopt, sizeof(sockopt));
+	}
+
+	error = bind(*fd, servinfo->ai_addr, servinfo->ai_addrlen);
+	if (error) {
+		error = errno;
+		std::cerr << "dlink: bind(): " << strerror(error) << std::endl;
+		freeaddrinfo(servinfo);
+		try_close(*fd);
+		return -1;
+	}
+	freeaddrinfo(servinfo);
+
+	fcntl(*fd, F_SETFL, O_NONBLOCK);
+
+	return 0;
+}
+
+udp_engine::udp_engine(ev::loop_ref loop, const char* name)
+	: name_(name), sock_v4_(-1), sock_v6_(-1), ev_readable_v4_(loop), ev_readable_v6_(loop), stats_(),
+	  loop_(loop), ev_repeat_(loop), slot_(0.02)
+{
+	ev_repeat_.set<udp_engine, &udp_engine::repeat_due>(this);
+}
+
+udp_engine::~udp_engine()
+{
+	close();
+}
+
+bool udp_engine::open(uint16_t port)
+{
+	auto p = std::to_string(port);
+
+	if (try_create_socket(p.c_str(), AF_INET6, &sock_v6_) || try_create_socket(p.c_str(), AF_INET, &sock_v4_)) {
+		close();
+		return false;
+	}
+
+	ev_readable_v6_.start(sock_v6_, ev::READ);
+	ev_readable_v4_.start(sock_v4_, ev::READ);
+	return true;
+}
+
+void udp_engine::close()
+{
+	ev_readable_v4_.stop();
+	ev_readable_v6_.stop();
+	ev_repeat_.stop();
+	repeats_.clear();
+	try_close(sock_v4_);
+	try_close(sock_v6_);
+}
+
+void udp_engine::send(const sockaddr_storage& to, const void* buf, size_t len)
+{
+	if (!send_one(to, buf, len) || repeats_.empty()) return;
+
+	// Ride along with the voice: anything for this peer that would be
+	// due within the next slot goes out now.
+	peer_key key(to);
+	double now = loop_.now();
+	bool sent = false;
+	for (auto& r : repeats_) {
+		if (r.peer != key || r.due > now + slot_) continue;
+		send_one(r.to, r.data.data(), r.data.size());
+		r.remaining--;
+		r.due = now + slot_;
+		sent = true;
+	}
+	if (sent) schedule_repeats();
+}
+
+void udp_engine::send_repeated(const sockaddr_storage& to, const void* buf, size_t len, int copies)
+{
+	send_one(to, buf, len);
+	if (copies <= 1) return;
+
+	auto data = static_cast<const uint8_t*>(buf);
+	repeats_.push_back({to, peer_key(to), std::vector<uint8_t>(data, data + len), copies - 1, loop_.now() + slot_});
+	schedule_repeats();
+}
+
+void udp_engine::cancel_repeats(const peer_key& peer)
+{
+	std::erase_if(repeats_, [&](const pending_repeat& r) { return r.peer == peer; });
+	schedule_repeats();
+}
+
+void udp_engine::repeat_due(ev::timer&, int)
+{
+	double now = loop_.now();
+	for (auto& r : repeats_) {
+		if (r.due > now) continue;
+		send_one(r.to, r.data.data(), r.data.size());
+		r.remaining--;
+		r.due = now + slot_;
+	}
+	schedule_repeats();
+}
+
+// Drops finished repeats and wakes up for the next one due.
+void udp_engine::schedule_repeats()
+{
+	std::erase_if(repeats_, [](const pending_repeat& r) { return r.remaining <= 0; });
+
+	ev_repeat_.stop();
+	if (repeats_.empty()) return;
+
+	double due = repeats_.front().due;
+	for (auto& r : repeats_)
+		due = std::min(due, r.due);
+
+	ev_repeat_.set(std::max(due - loop_.now(), 0.), 0.);
+	ev_repeat_.start();
+}
+
+bool udp_engine::send_one(const sockaddr_storage& to, const void* buf, size_t len)
+{
+	int result;
+	if (to.ss_family == AF_INET) {
+		result = sendto(sock_v4_, buf, len, 0, (sockaddr*)&to, sizeof(sockaddr_in));
+	}
+	else {
+		result = sendto(sock_v6_, buf, len, 0, (sockaddr*)&to, sizeof(sockaddr_in6));
+	}
+
+	if (result == -1) {
+		int error = errno;
+		if (error == EAGAIN || error == EWOULDBLOCK) {
+			stats_.tx_dropped++;
+			std::cerr << "dlink: " << name_ << ": sendto() returned EAGAIN!" << std::endl;
+			// TODO: How often is this, do we need a resend queue?
+		}
+		else {
+			stats_.tx_errors++;
+			std::cerr << "dlink: " << name_ << ": sendto(): error ";
+			std::cerr << strerror(error) << std::endl;
+		}
+		return false;
+	}
+
+	stats_.tx_packets++;
+	stats_.tx_bytes += len;
+	return true;
+}
+
+void udp_engine::send_batch(std::vector<mmsghdr>& v4, std::vector<mmsghdr>& v6)
+{
+	send_batch(sock_v4_, v4);
+	send_batch(sock_v6_, v6);
+}
+
+void udp_engine::send_batch(int sock, std::vector<mmsghdr>& msgs)
+{
+	size_t sent = 0;
+	while (sent < msgs.size()) {
+		int n = sendmmsg(sock, msgs.data() + sent, msgs.size() - sent, 0);
+		if (n == -1) {
+			int error = errno;
+			if (error == EINTR) continue;
+			if (error == EAGAIN || error == EWOULDBLOCK) {
+				stats_.tx_dropped += msgs.size() - sent;
+				std::cerr << "dlink: " << name_ << ": sendmmsg() returned EAGAIN, dropped " << msgs.size() - sent << " datagrams" << std::endl;
+				return;
+			}
+
+			// Only the first datagram failed, skip that peer.
+			stats_.tx_errors++;
+			std::cerr << "dlink: " << name_ << ": sendmmsg(): " << strerror(error) << std::endl;
+			sent++;
+			continue;
+		}
+
+		for (int i = 0; i < n; i++) {
+			stats_.tx_packets++;
+			stats_.tx_bytes += msgs[sent + i].msg_len;
+		}
+		sent += n;
+	}
+}
+
+int udp_engine::receive(int sock, void* bufs, size_t size, sockaddr_storage* from, unsigned* lens)
+{
+	mmsghdr msgs[recv_batch];
+	iovec iov[recv_batch];
+
+	std::memset(msgs, 0, sizeof(msgs));
+	for (int i = 0; i < recv_batch; i++) {
+		iov[i].iov_base = static_cast<char*>(bufs) + i * size;
+		iov[i].iov_len = size;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+	}
+
+	int n = recvmmsg(sock, msgs, recv_batch, MSG_DONTWAIT, nullptr);
+	if (n == -1) {
+		int error = errno;
+		if (error != EAGAIN && error != EWOULDBLOCK && error != EINTR) {
+			stats_.rx_errors++;
+			std::cerr << "dlink: " << name_ << ": recvmmsg(): " << strerror(error) << std::endl;
+		}
+		return 0;
+	}
+
+	int count = 0;
+	for (int i = 0; i < n; i++) {
+		// Zero length datagrams are never valid.
+		if (msgs[i].msg_len == 0) continue;
+
+		stats_.rx_packets++;
+		stats_.rx_bytes += msgs[i].msg_len;
+
+		if (count != i) {
+			std::memmove(static_cast<char*>(bufs) + count * size, static_cast<char*>(bufs) + i * size, msgs[i].msg_len);
+			from[count] = from[i];
+		}
+		lens[count] = msgs[i].msg_len;
+		count++;
+	}
+
+	return count;
+}
+
+}// namespace dlink
@@ -0,0 +1,169 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DLINK_ENGINE_H
+#define DLINK_ENGINE_H
+
+#include "common/c++sock.h"
+#include "dlink/proto.h"
+#include "dv/slow_header.h"
+#include <cstdint>
+#include <ev++.h>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <vector>
+
+namespace dlink {
+
+struct link;
+
+// Voice from a reflector whose header we never got.
+struct late_stream {
+	peer_key peer;
+	dv::slow_header decoder;
+};
+
+// A packet that still has copies to go out.
+struct pending_repeat {
+	sockaddr_storage to;
+	peer_key peer;
+	std::vector<uint8_t> data;
+	int remaining;
+	double due;
+};
+
+struct engine_stats {
+	uint64_t rx_packets;
+	uint64_t rx_bytes;
+	uint64_t rx_errors;
+	uint64_t tx_packets;
+	uint64_t tx_bytes;
+	uint64_t tx_errors;
+	uint64_t tx_dropped;// EAGAIN
+};
+
+// The sockets of one link protocol: one v4 and one v6 socket bound to
+// the protocol's port. Anything sending on them goes through here so
+// every protocol gets the same batching and counters.
+class udp_engine {
+public:
+	udp_engine(ev::loop_ref loop, const char* name);
+	~udp_engine();
+	udp_engine(const udp_engine&) = delete;
+	udp_engine& operator=(const udp_engine&) = delete;
+
+	bool open(uint16_t port);
+	void close();
+
+	void send(const sockaddr_storage& to, const void* buf, size_t len);
+	// Sends buf now and copies - 1 more times, one per slot, instead of
+	// in a burst that a full queue drops all at once. While voice is
+	// going to the same peer the copies go out right behind the voice
+	// frames.
+	void send_repeated(const sockaddr_storage& to, const void* buf, size_t len, int copies);
+	// Drops the copies still queued for peer.
+	void cancel_repeats(const peer_key& peer);
+	void set_slot(double seconds)
+	{
+		slot_ = seconds;
+	}
+	// Sends every message on the socket of its family, one sendmmsg()
+	// per batch.
+	void send_batch(std::vector<mmsghdr>& v4, std::vector<mmsghdr>& v6);
+
+	const engine_stats& stats() const
+	{
+		return stats_;
+	}
+
+	const char* name() const
+	{
+		return name_;
+	}
+
+protected:
+	static constexpr int recv_batch = 16;
+
+	void send_batch(int sock, std::vector<mmsghdr>& msgs);
+	bool send_one(const sockaddr_storage& to, const void* buf, size_t len);
+	void repeat_due(ev::timer&, int);
+	void schedule_repeats();
+	// Receives up to recv_batch datagrams into bufs. Returns how many.
+	int receive(int sock, void* bufs, size_t size, sockaddr_storage* from, unsigned* lens);
+
+	const char* name_;
+	int sock_v4_;
+	int sock_v6_;
+	ev::io ev_readable_v4_;
+	ev::io ev_readable_v6_;
+	engine_stats stats_;
+
+	ev::loop_ref loop_;
+	ev::timer ev_repeat_;
+	double slot_;// A voice frame
+	std::vector<pending_repeat> repeats_;
+};
+
+// A udp_engine that knows its packet layout through the traits P (see
+// xrf_traits) and hands every datagram to H::on_packet().
+template <typename P, typename H>
+class link_engine : public udp_engine {
+public:
+	using traits = P;
+	using packet = typename P::packet;
+
+	link_engine(ev::loop_ref loop, H* handler) : udp_engine(loop, P::name), handler_(handler)
+	{
+		ev_readable_v4_.set<link_engine, &link_engine::readable>(this);
+		ev_readable_v6_.set<link_engine, &link_engine::readable>(this);
+	}
+
+	bool open()
+	{
+		return udp_engine::open(P::port);
+	}
+
+	// Inbound stream id to the link it's being played on.
+	std::unordered_map<uint16_t, link*> streams;
+	// Reflector address to the links using it.
+	peer_table<std::vector<link*>> peers;
+	// Inbound streams still waiting for a header.
+	std::unordered_map<uint16_t, late_stream> late;
+
+private:
+	void readable(ev::io& w, int)
+	{
+		packet bufs[recv_batch];
+		sockaddr_storage from[recv_batch];
+		unsigned lens[recv_batch];
+
+		int n = receive(w.fd, bufs, sizeof(packet), from, lens);
+		for (int i = 0; i < n; i++)
+			handler_->on_packet(*this, bufs[i], lens[i], from[i]);
+	}
+
+	H* handler_;
+};
+
+}// namespace dlink
+
+#endif
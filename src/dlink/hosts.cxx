@@ -0,0 +1,236 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "hosts.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace dlink {
+
+static constexpr char HOST_DB_MAGIC[8] = {'D', 'G', 'H', 'O', 'S', 'T', 'S', '1'};
+
+sockaddr_storage host_entry::sockaddr(uint16_t port) const
+{
+	sockaddr_storage ss;
+	std::memset(&ss, 0, sizeof(ss));
+
+	if (family == AF_INET) {
+		auto sin = reinterpret_cast<sockaddr_in*>(&ss);
+		sin->sin_family = AF_INET;
+		sin->sin_port = htons(port);
+		std::memcpy(&sin->sin_addr, addr, 4);
+	}
+	else {
+		auto sin6 = reinterpret_cast<sockaddr_in6*>(&ss);
+		sin6->sin6_family = AF_INET6;
+		sin6->sin6_port = htons(port);
+		std::memcpy(&sin6->sin6_addr, addr, 16);
+	}
+
+	return ss;
+}
+
+host_db::host_db() : map_(nullptr), map_size_(0), entries_(nullptr), count_(0) {}
+
+host_db::~host_db()
+{
+	unmap();
+}
+
+void host_db::unmap()
+{
+	if (map_ != nullptr) munmap(map_, map_size_);
+	map_ = nullptr;
+	map_size_ = 0;
+	entries_ = nullptr;
+	count_ = 0;
+}
+
+static std::string_view next_field(std::string_view& line)
+{
+	auto start = line.find_first_not_of(" \t\r");
+	if (start == std::string_view::npos) {
+		line = {};
+		return {};
+	}
+	line.remove_prefix(start);
+
+	auto end = line.find_first_of(" \t\r");
+	auto field = line.substr(0, end);
+	line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+	return field;
+}
+
+int host_db::compile(const std::string& text_path, const std::string& db_path)
+{
+	std::ifstream hosts(text_path);
+	if (!hosts) {
+		std::cerr << "dlink: could not open " << text_path << std::endl;
+		return -1;
+	}
+
+	std::vector<host_entry> entries;
+	int bad = 0;
+
+	for (std::string line; std::getline(hosts, line);) {
+		std::string_view rest = line;
+		auto name = next_field(rest);
+		auto ip = next_field(rest);
+		if (name.empty() || name[0] == '#') continue;
+
+		host_entry e;
+		std::memset(&e, 0, sizeof(e));
+
+		// TODO: if we want to link to Repeaters we need to check before we truncate
+		e.name = dv::callsign(name).upper().truncate(6).value();
+
+		char text[INET6_ADDRSTRLEN] = {};
+		ip.copy(text, std::min(ip.size(), sizeof(text) - 1));
+		if (inet_pton(AF_INET, text, e.addr) == 1) {
+			e.family = AF_INET;
+		}
+		else if (inet_pton(AF_INET6, text, e.addr) == 1) {
+			e.family = AF_INET6;
+		}
+		else {
+			bad++;
+			continue;
+		}
+
+		entries.push_back(e);
+	}
+
+	if (bad) std::cerr << "dlink: " << text_path << ": skipped " << bad << " lines without a numeric address" << std::endl;
+
+	// Later lines win.
+	std::stable_sort(entries.begin(), entries.end(), [](const host_entry& a, const host_entry& b) { return a.name < b.name; });
+	std::vector<host_entry> unique;
+	unique.reserve(entries.size());
+	for (const auto& e : entries) {
+		if (!unique.empty() && unique.back().name == e.name)
+			unique.back() = e;
+		else
+			unique.push_back(e);
+	}
+
+	host_db_header h;
+	std::memcpy(h.magic, HOST_DB_MAGIC, sizeof(h.magic));
+	h.count = unique.size();
+	h.entry_size = sizeof(host_entry);
+
+	// Write next to the target and rename over it, so a reader never sees
+	// half a file.
+	std::string tmp = db_path + ".tmp";
+	FILE* f = std::fopen(tmp.c_str(), "wb");
+	if (f == nullptr) {
+		std::cerr << "dlink: could not write " << tmp << ": " << strerror(errno) << std::endl;
+		return -1;
+	}
+
+	bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+	if (!unique.empty()) ok = ok && std::fwrite(unique.data(), sizeof(host_entry), unique.size(), f) == unique.size();
+	ok = std::fclose(f) == 0 && ok;
+
+	if (!ok || std::rename(tmp.c_str(), db_path.c_str()) != 0) {
+		std::cerr << "dlink: could not write " << db_path << ": " << strerror(errno) << std::endl;
+		std::remove(tmp.c_str());
+		return -1;
+	}
+
+	return unique.size();
+}
+
+bool host_db::load(const std::string& db_path)
+{
+	int fd = open(db_path.c_str(), O_RDONLY);
+	if (fd == -1) {
+		std::cerr << "dlink: could not open " << db_path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(host_db_header)) {
+		close(fd);
+		std::cerr << "dlink: " << db_path << " is not a host database" << std::endl;
+		return false;
+	}
+
+	void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		std::cerr << "dlink: mmap(): " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	auto h = static_cast<const host_db_header*>(map);
+	if (std::memcmp(h->magic, HOST_DB_MAGIC, sizeof(h->magic)) != 0 || h->entry_size != sizeof(host_entry) || sizeof(host_db_header) + (size_t)h->count * sizeof(host_entry) > (size_t)st.st_size) {
+		munmap(map, st.st_size);
+		std::cerr << "dlink: " << db_path << " is not a host database" << std::endl;
+		return false;
+	}
+
+	unmap();
+	map_ = map;
+	map_size_ = st.st_size;
+	entries_ = reinterpret_cast<const host_entry*>(static_cast<const char*>(map) + sizeof(host_db_header));
+	count_ = h->count;
+
+	return true;
+}
+
+bool host_db::update(const std::string& text_path, const std::string& db_path)
+{
+	struct stat text_st;
+	struct stat db_st;
+
+	bool have_text = stat(text_path.c_str(), &text_st) == 0;
+	bool have_db = stat(db_path.c_str(), &db_st) == 0;
+
+	if (have_text && (!have_db || text_st.st_mtim.tv_sec > db_st.st_mtim.tv_sec || (text_st.st_mtim.tv_sec == db_st.st_mtim.tv_sec && text_st.st_mtim.tv_nsec >= db_st.st_mtim.tv_nsec))) {
+		if (compile(text_path, db_path) < 0) return false;
+	}
+
+	return load(db_path);
+}
+
+const host_entry* host_db::find(dv::callsign name) const
+{
+	auto key = name.upper().truncate(6).value();
+	auto end = entries_ + count_;
+	auto it = std::lower_bound(entries_, end, key, [](const host_entry& e, uint64_t k) { return e.name < k; });
+	if (it == end || it->name != key) return nullptr;
+	return it;
+}
+
+}// namespace dlink
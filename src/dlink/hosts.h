@@ -0,0 +1,92 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DLINK_HOSTS_H
+#define DLINK_HOSTS_H
+
+#include "dv/callsign.h"
+#include <cstdint>
+#include <string>
+#include <sys/socket.h>
+
+namespace dlink {
+
+#pragma pack(push, 1)
+struct host_entry {
+	uint64_t name;   // dv::callsign::value()
+	uint8_t addr[16];// in_addr or in6_addr
+	uint16_t family;
+	uint8_t pad[6];
+
+	// The address with the given port (host order) filled in.
+	sockaddr_storage sockaddr(uint16_t port) const;
+};
+
+struct host_db_header {
+	char magic[8];
+	uint32_t count;
+	uint32_t entry_size;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(host_entry) == 32);
+
+// Reflector name to address table. The text hosts file ("NAME ADDRESS"
+// per line) is compiled once into a sorted binary file, which is mapped
+// read only and binary searched.
+class host_db {
+public:
+	host_db();
+	~host_db();
+	host_db(const host_db&) = delete;
+	host_db& operator=(const host_db&) = delete;
+
+	// Parses and resolves a text hosts file and writes the binary form.
+	// The file is replaced atomically. Returns the number of entries, or
+	// -1 on error.
+	static int compile(const std::string& text_path, const std::string& db_path);
+
+	// Maps a compiled file. The old table stays in use if this fails.
+	bool load(const std::string& db_path);
+
+	// Compiles text_path into db_path if it is newer, then loads it.
+	bool update(const std::string& text_path, const std::string& db_path);
+
+	const host_entry* find(dv::callsign name) const;
+
+	size_t size() const
+	{
+		return count_;
+	}
+
+private:
+	void unmap();
+
+	void* map_;
+	size_t map_size_;
+	const host_entry* entries_;
+	size_t count_;
+};
+
+}// namespace dlink
+
+#endif
@@ -20,10 +20,58 @@
 //
 
 #include "app.h"
+#include <iostream>
+#include <string>
+#include <unistd.h>
 
-int main()
+static void usage(const char* argv0)
 {
-	dlink::app app("dgate.sock", "KO6JXH", "hosts", {'C'});
+	std::cerr << "usage: " << argv0 << " [-m modules] [-b ab] [-x XRFnnn:modules]" << std::endl;
+	std::cerr << "  -m  modules to link, default C" << std::endl;
+	std::cerr << "  -b  bridge the links of modules a and b, e.g. -b BC" << std::endl;
+	std::cerr << "  -x  also serve as an XRF reflector, e.g. -x XRF999:ABC" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	std::string mods = "C";
+	std::string bridge;
+	std::string xrf;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "m:b:x:")) != -1) {
+		switch (opt) {
+		case 'm':
+			mods = optarg;
+			break;
+		case 'b':
+			bridge = optarg;
+			break;
+		case 'x':
+			xrf = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	dlink::app app("dgate.sock", "KO6JXH", "hosts", {mods.begin(), mods.end()});
+
+	if (!bridge.empty() && (bridge.size() != 2 || !app.bridge(bridge[0], bridge[1]))) {
+		std::cerr << "dlink: cannot bridge \"" << bridge << "\", need two different modules from -m" << std::endl;
+		return 1;
+	}
+
+	if (!xrf.empty()) {
+		auto colon = xrf.find(':');
+		if (colon == std::string::npos || colon == 0 || colon + 1 == xrf.size()) {
+			usage(argv[0]);
+			return 1;
+		}
+		auto served = xrf.substr(colon + 1);
+		app.serve_xrf(dv::callsign(xrf.substr(0, colon)).upper(), {served.begin(), served.end()});
+	}
 
 	app.setup();
 	app.run();
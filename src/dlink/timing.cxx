@@ -0,0 +1,95 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "timing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace dlink {
+
+static constexpr double alpha = 1. / 8.;
+static constexpr double beta = 1. / 4.;
+
+static int bucket(double seconds)
+{
+	double ms = seconds * 1000.;
+	if (ms < 2.) return 0;
+	return std::min(static_cast<int>(std::log2(ms)), link_timing::buckets - 1);
+}
+
+void link_timing::reset()
+{
+	std::memset(this, 0, sizeof(*this));
+}
+
+void link_timing::request(double now)
+{
+	requested = now;
+}
+
+void link_timing::ack(double now)
+{
+	if (requested == 0.) return;
+	double r = now - requested;
+	requested = 0.;
+
+	if (!have_rtt) {
+		srtt = r;
+		rttvar = r / 2.;
+		have_rtt = true;
+	}
+	else {
+		rttvar += beta * (std::abs(srtt - r) - rttvar);
+		srtt += alpha * (r - srtt);
+	}
+	rtt_hist[bucket(r)]++;
+}
+
+void link_timing::heard(double now)
+{
+	if (heartbeats++ > 0) {
+		double i = now - last_heard;
+		if (heartbeats == 2) {
+			interval = i;
+			jitter = i / 2.;
+		}
+		else {
+			double dev = std::abs(interval - i);
+			jitter += beta * (dev - jitter);
+			interval += alpha * (i - interval);
+			jitter_hist[bucket(dev)]++;
+		}
+	}
+	last_heard = now;
+}
+
+// Long enough to ride out a few lost heartbeats plus the usual jitter.
+// Until the reflector's heartbeat rate is known, the old fixed timeout.
+double link_timing::timeout() const
+{
+	if (heartbeats < 3) return initial_timeout;
+	double t = missed_heartbeats * interval + 4. * jitter + (have_rtt ? srtt : 0.);
+	return std::clamp(t, min_timeout, max_timeout);
+}
+
+}// namespace dlink
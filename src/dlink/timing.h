@@ -0,0 +1,72 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DLINK_TIMING_H
+#define DLINK_TIMING_H
+
+#include <cstdint>
+
+namespace dlink {
+
+// Round trip and heartbeat figures of one link, and the timeout that
+// follows from them. The estimators are the ones TCP uses for its
+// retransmit timer (RFC 6298).
+struct link_timing {
+	static constexpr double initial_timeout = 5.;
+	static constexpr double min_timeout = 2.;
+	static constexpr double max_timeout = 30.;
+	static constexpr double heartbeat_period = 1.;
+	// Heartbeats that may go missing before the link is given up.
+	static constexpr int missed_heartbeats = 3;
+
+	// Log2 buckets of milliseconds: bucket 0 is under 2 ms, bucket i
+	// is [2^i, 2^(i+1)) ms and the last one is everything above.
+	static constexpr int buckets = 16;
+
+	void reset();
+
+	// A link request went out.
+	void request(double now);
+	// Its ack came back.
+	void ack(double now);
+	// The reflector's heartbeat arrived.
+	void heard(double now);
+
+	double timeout() const;
+
+	double requested;
+	bool have_rtt;
+	double srtt;
+	double rttvar;
+
+	double last_heard;
+	uint32_t heartbeats;
+	double interval;// Between the reflector's heartbeats
+	double jitter;  // Mean deviation of the interval
+
+	uint32_t rtt_hist[buckets];
+	uint32_t jitter_hist[buckets];
+};
+
+}// namespace dlink
+
+#endif
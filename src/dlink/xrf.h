@@ -35,6 +35,7 @@
 #ifndef DGATE_XRF_H
 #define DGATE_XRF_H
 
+#include "dlink/proto.h"
 #include "dv/types.h"
 #include <cstring>
 namespace dlink {
@@ -116,6 +117,136 @@ struct xrf_packet {
 
 #pragma pack(pop)
 
+// Everything the link engine needs to know about XRF (DExtra).
+struct xrf_traits {
+	using packet = xrf_packet;
+
+	static constexpr link_proto proto = L_XRF;
+	static constexpr const char* name = "xrf";
+	static constexpr uint16_t port = 30001;
+
+	static constexpr bool header_packets = true;
+	static constexpr bool voice_has_header = false;
+
+	static inline packet_kind classify(const packet& p, size_t len)
+	{
+		switch (len) {
+		case sizeof(xrf_packet_heartbeat):
+			return p.is_heartbeat() ? K_HEARTBEAT : K_UNKNOWN;
+		case sizeof(xrf_packet_link_ack):
+			if (!p.is_ack()) return K_UNKNOWN;
+			return p.ack.ack[0] == 'N' ? K_NAK : K_ACK;
+		case sizeof(xrf_packet_header):
+			return p.is_header() ? K_HEADER : K_UNKNOWN;
+		case sizeof(xrf_packet_voice):
+			return p.is_voice() ? K_VOICE : K_UNKNOWN;
+		}
+		return K_UNKNOWN;
+	}
+
+	// Link request, or unlink if mod_to is ' '.
+	static inline size_t link(packet& p, dv::callsign cs, char mod_from, char mod_to, dv::callsign)
+	{
+		cs.to_field(p.link.from);
+		p.link.mod_from = mod_from;
+		p.link.mod_to = mod_to;
+		p.link.null = 0;
+		return sizeof(xrf_packet_link);
+	}
+
+	static inline size_t unlink(packet& p, dv::callsign cs, char mod_from, dv::callsign)
+	{
+		return link(p, cs, mod_from, ' ', {});
+	}
+
+	static inline size_t heartbeat(packet& p, dv::callsign cs, char, dv::callsign)
+	{
+		cs.to_field(p.heartbeat.from);
+		p.heartbeat.from[8] = 0;
+		return sizeof(xrf_packet_heartbeat);
+	}
+
+	static inline size_t header(packet& p, const dv::header& h, uint16_t id, dv::callsign rpt1, dv::callsign rpt2)
+	{
+		std::memcpy(p.header.title, "DSVT", 4);
+		p.header.config = 0x10U;
+		p.header.flaga[0] = 0;
+		p.header.flaga[1] = 0;
+		p.header.flaga[2] = 0;
+		p.header.id = 0x20;
+		p.header.flagb[0] = 0;
+		p.header.flagb[1] = 1;
+		p.header.ctrl = 0x80U;
+		p.header.header = h;
+		return retarget_header(p, id, rpt1, rpt2);
+	}
+
+	// Points a received header at another reflector, in place.
+	static inline size_t retarget_header(packet& p, uint16_t id, dv::callsign rpt1, dv::callsign rpt2)
+	{
+		p.header.streamid = id;
+		p.header.flagb[2] = rpt2.module();
+		rpt2.to_field(p.header.header.destination_rptr_cs);
+		rpt1.to_field(p.header.header.departure_rptr_cs);
+		p.header.header.set_crc(p.header.header.calc_crc());
+		return sizeof(xrf_packet_header);
+	}
+
+	static inline size_t voice(packet& p, const dv::header&, uint16_t id, uint8_t seqno, bool end, const dv::rf_frame& f, uint32_t)
+	{
+		std::memcpy(p.voice.title, "DSVT", 4);
+		p.voice.config = 0x20U;
+		p.voice.flaga[0] = 0;
+		p.voice.flaga[1] = 0;
+		p.voice.flaga[2] = 0;
+		p.voice.id = 0x20;
+		p.voice.flagb[0] = 0;
+		p.voice.flagb[1] = 1;
+		p.voice.flagb[2] = 1;// TODO: does this even matter
+		p.voice.streamid = id;
+		p.voice.seqno = end ? 0x40U | seqno : seqno;
+		p.voice.frame = f;
+		return sizeof(xrf_packet_voice);
+	}
+
+	static inline size_t retarget_voice(packet& p, const dv::header&, uint16_t id)
+	{
+		p.voice.streamid = id;
+		return sizeof(xrf_packet_voice);
+	}
+
+	static inline uint16_t stream_id(const packet& p, packet_kind k)
+	{
+		return k == K_HEADER ? p.header.streamid : p.voice.streamid;
+	}
+
+	static inline const dv::header& get_header(const packet& p)
+	{
+		return p.header.header;
+	}
+
+	static inline uint8_t seqno(const packet& p)
+	{
+		return p.voice.seqno & 0x1FU;
+	}
+
+	static inline bool is_end(const packet& p)
+	{
+		return p.voice.seqno & 0x40U;
+	}
+
+	static inline const dv::rf_frame& frame(const packet& p)
+	{
+		return p.voice.frame;
+	}
+
+	// The local module an ack is for.
+	static inline char ack_module(const packet& p)
+	{
+		return p.ack.mod_from;
+	}
+};
+
 }// namespace dlink
 
 #endif
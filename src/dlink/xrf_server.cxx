@@ -0,0 +1,316 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "xrf_server.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace dlink {
+
+xrf_server::xrf_server(ev::loop_ref loop, dv::callsign name, const std::unordered_set<char>& modules, udp_engine& io)
+	: loop_(loop), ev_tick_(loop), name_(name), io_(io)
+{
+	for (char c : modules) {
+		auto& m = modules_[c];
+		m.active = false;
+		m.stream = 0;
+		m.last_frame = 0.;
+		m.dirty = true;
+	}
+
+	ev_tick_.set<xrf_server, &xrf_server::tick>(this);
+	ev_tick_.start(1., 1.);
+}
+
+size_t xrf_server::peers() const
+{
+	return peers_.size();
+}
+
+bool xrf_server::handle_packet(const xrf_packet& p, size_t len, const sockaddr_storage& from)
+{
+	switch (len) {
+	case sizeof(xrf_packet_link):
+		handle_link(p, from);
+		return true;
+
+	case sizeof(xrf_packet_heartbeat): {
+		if (!p.is_heartbeat()) return false;
+
+		auto it = gateways_.find(dv::callsign::from_field(p.heartbeat.from));
+		if (it == gateways_.end() || it->second.peer != peer_key(from)) return false;
+
+		it->second.last_heard = loop_.now();
+		return true;
+	}
+
+	// Streams are only ours if they come from the gateway that owns
+	// them; anything else may belong to a reflector we link to.
+	case sizeof(xrf_packet_header): {
+		if (!p.is_header() || !owned_by(p.header.header.departure_rptr(), from)) return false;
+
+		handle_header(p);
+		return true;
+	}
+
+	case sizeof(xrf_packet_voice): {
+		if (!p.is_voice()) return false;
+		auto it = streams_.find(p.voice.streamid);
+		if (it == streams_.end() || !owned_by(modules_[it->second].source, from)) return false;
+
+		handle_voice(p);
+		return true;
+	}
+	}
+
+	return false;
+}
+
+bool xrf_server::owned_by(dv::callsign cs, const sockaddr_storage& from) const
+{
+	auto pr = peers_.find(cs);
+	if (pr == peers_.end()) return false;
+	auto gw = gateways_.find(pr->second.gateway);
+	return gw != gateways_.end() && gw->second.peer == peer_key(from);
+}
+
+void xrf_server::handle_link(const xrf_packet& p, const sockaddr_storage& from)
+{
+	auto cs = dv::callsign::from_field(p.link.from).with_module(p.link.mod_from);
+
+	if (p.link.mod_to == ' ') {
+		auto it = peers_.find(cs);
+		if (it != peers_.end() && gateways_[it->second.gateway].peer == peer_key(from)) {
+			std::cout << "xrf_server: " << cs << " unlinked" << std::endl;
+			remove_peer(cs);
+		}
+		return;
+	}
+
+	xrf_packet r;
+	std::memcpy(r.ack.from, p.link.from, sizeof(r.ack.from));
+	r.ack.mod_from = p.link.mod_from;
+	r.ack.mod_to = p.link.mod_to;
+	r.ack.null = 0;
+
+	if (modules_.contains(p.link.mod_to) && add_peer(cs, p.link.mod_to, from)) {
+		std::cout << "xrf_server: " << cs << " linked to " << p.link.mod_to << std::endl;
+		std::memcpy(r.ack.ack, "ACK", 3);
+	}
+	else {
+		std::memcpy(r.ack.ack, "NAK", 3);
+	}
+
+	io_.send(from, &r, sizeof(xrf_packet_link_ack));
+}
+
+void xrf_server::handle_header(const xrf_packet& p)
+{
+	auto cs = p.header.header.departure_rptr();
+	auto& pr = peers_[cs];
+	auto& gw = gateways_[pr.gateway];
+
+	auto now = loop_.now();
+	gw.last_heard = now;
+
+	auto& m = modules_[pr.module];
+	auto id = p.header.streamid;
+
+	bool repeat = m.active && m.stream == id && m.source == cs;
+	if (!repeat) {
+		// One talker per module.
+		if (m.active && now - m.last_frame < stream_timeout) return;
+		if (m.active) streams_.erase(m.stream);
+
+		m.active = true;
+		m.stream = id;
+		m.source = cs;
+		m.dirty = true;
+		streams_[id] = pr.module;
+	}
+	m.last_frame = now;
+
+	xrf_packet out = p;
+	out.header.flagb[2] = pr.module;
+	name_.with_module(pr.module).to_field(out.header.header.destination_rptr_cs);
+	name_.with_module('G').to_field(out.header.header.departure_rptr_cs);
+	out.header.header.set_crc(out.header.header.calc_crc());
+
+	fanout(m, &out, sizeof(xrf_packet_header));
+}
+
+void xrf_server::handle_voice(const xrf_packet& p)
+{
+	auto mod = streams_[p.voice.streamid];
+	auto& m = modules_[mod];
+
+	auto& gw = gateways_[peers_[m.source].gateway];
+
+	auto now = loop_.now();
+	gw.last_heard = now;
+	m.last_frame = now;
+
+	fanout(m, &p, sizeof(xrf_packet_voice));
+
+	if (p.voice.seqno & 0x40U) {
+		m.active = false;
+		m.dirty = true;
+		streams_.erase(p.voice.streamid);
+	}
+}
+
+bool xrf_server::add_peer(dv::callsign cs, char mod, const sockaddr_storage& from)
+{
+	auto base = cs.base();
+
+	// A gateway has one address. Someone else claiming it only gets in
+	// once the old one has gone quiet, and then takes none of its links.
+	auto old = gateways_.find(base);
+	if (old != gateways_.end() && old->second.peer != peer_key(from)) {
+		if (loop_.now() - old->second.last_heard < peer_timeout) {
+			std::cout << "xrf_server: " << cs << " refused, gateway is linked from another address" << std::endl;
+			return false;
+		}
+		remove_gateway(base);
+	}
+
+	if (peers_.contains(cs)) remove_peer(cs);
+
+	auto& gw = gateways_[base];
+	gw.addr = from;
+	gw.peer = peer_key(from);
+	gw.last_heard = loop_.now();
+	gw.links.push_back(cs);
+
+	peers_[cs] = {base, mod};
+
+	auto& m = modules_[mod];
+	m.peers.push_back(cs);
+	m.dirty = true;
+	return true;
+}
+
+void xrf_server::remove_peer(dv::callsign cs)
+{
+	auto it = peers_.find(cs);
+	if (it == peers_.end()) return;
+
+	auto pr = it->second;
+	peers_.erase(it);
+
+	auto& m = modules_[pr.module];
+	m.peers.erase(std::remove(m.peers.begin(), m.peers.end(), cs), m.peers.end());
+	m.dirty = true;
+	if (m.active && m.source == cs) {
+		m.active = false;
+		streams_.erase(m.stream);
+	}
+
+	auto& gw = gateways_[pr.gateway];
+	gw.links.erase(std::remove(gw.links.begin(), gw.links.end(), cs), gw.links.end());
+	if (gw.links.empty()) gateways_.erase(pr.gateway);
+}
+
+void xrf_server::remove_gateway(dv::callsign base)
+{
+	auto links = gateways_[base].links;
+	for (auto cs : links)
+		remove_peer(cs);
+	gateways_.erase(base);
+}
+
+void xrf_server::build_fanout(module& m)
+{
+	m.addrs.clear();
+	for (auto cs : m.peers) {
+		if (m.active && cs == m.source) continue;
+		m.addrs.push_back(gateways_[peers_[cs].gateway].addr);
+	}
+
+	// Filled in only once addrs is done growing, so msg_name stays valid.
+	m.msgs_v4.clear();
+	m.msgs_v6.clear();
+	for (auto& addr : m.addrs) {
+		mmsghdr h;
+		std::memset(&h, 0, sizeof(h));
+		h.msg_hdr.msg_name = &addr;
+		h.msg_hdr.msg_iov = &m.iov;
+		h.msg_hdr.msg_iovlen = 1;
+
+		if (addr.ss_family == AF_INET) {
+			h.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			m.msgs_v4.push_back(h);
+		}
+		else {
+			h.msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+			m.msgs_v6.push_back(h);
+		}
+	}
+
+	m.dirty = false;
+}
+
+void xrf_server::fanout(module& m, const void* buf, size_t len)
+{
+	if (m.dirty) build_fanout(m);
+
+	// Every peer gets the same datagram.
+	m.iov.iov_base = const_cast<void*>(buf);
+	m.iov.iov_len = len;
+
+	io_.send_batch(m.msgs_v4, m.msgs_v6);
+}
+
+void xrf_server::tick(ev::timer&, int)
+{
+	auto now = loop_.now();
+
+	std::vector<dv::callsign> expired;
+	xrf_packet hb;
+	name_.to_field(hb.heartbeat.from);
+	hb.heartbeat.from[8] = 0;
+
+	for (auto& [base, gw] : gateways_) {
+		if (now - gw.last_heard > peer_timeout) {
+			expired.push_back(base);
+			continue;
+		}
+		io_.send(gw.addr, &hb, sizeof(xrf_packet_heartbeat));
+	}
+
+	for (auto base : expired) {
+		std::cout << "xrf_server: " << base << " timed out" << std::endl;
+		remove_gateway(base);
+	}
+
+	// Streams that never sent an end frame.
+	for (auto& [c, m] : modules_) {
+		if (m.active && now - m.last_frame > stream_timeout) {
+			m.active = false;
+			m.dirty = true;
+			streams_.erase(m.stream);
+		}
+	}
+}
+
+}// namespace dlink
@@ -0,0 +1,113 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DLINK_XRF_SERVER_H
+#define DLINK_XRF_SERVER_H
+
+#include "common/c++sock.h"
+#include "dlink/engine.h"
+#include "dv/types.h"
+#include "xrf.h"
+#include <ev++.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace dlink {
+
+// Accepts inbound XRF links and repeats every stream on a module to all
+// the other gateways linked to it.
+class xrf_server {
+public:
+	static constexpr double peer_timeout = 30.;
+	static constexpr double stream_timeout = 1.;
+
+	xrf_server(ev::loop_ref loop, dv::callsign name, const std::unordered_set<char>& modules, udp_engine& io);
+
+	// Returns false if the packet isn't for the reflector.
+	bool handle_packet(const xrf_packet& p, size_t len, const sockaddr_storage& from);
+
+	size_t peers() const;
+
+private:
+	struct gateway {
+		sockaddr_storage addr;
+		peer_key peer;
+		double last_heard;
+		std::vector<dv::callsign> links;// Gateway callsign with module
+	};
+
+	struct peer {
+		dv::callsign gateway;
+		char module;// Reflector module
+	};
+
+	struct module {
+		std::vector<dv::callsign> peers;
+
+		bool active;
+		uint16_t stream;
+		dv::callsign source;
+		double last_frame;
+
+		// Prebuilt fanout for the current stream, rebuilt when the peers
+		// or the source change.
+		bool dirty;
+		std::vector<sockaddr_storage> addrs;
+		std::vector<mmsghdr> msgs_v4;
+		std::vector<mmsghdr> msgs_v6;
+		iovec iov;
+	};
+
+	bool owned_by(dv::callsign cs, const sockaddr_storage& from) const;
+
+	void handle_link(const xrf_packet& p, const sockaddr_storage& from);
+	void handle_header(const xrf_packet& p);
+	void handle_voice(const xrf_packet& p);
+
+	// Returns false if the gateway is still alive at another address.
+	bool add_peer(dv::callsign cs, char mod, const sockaddr_storage& from);
+	void remove_peer(dv::callsign cs);
+	void remove_gateway(dv::callsign base);
+
+	void fanout(module& m, const void* buf, size_t len);
+	void build_fanout(module& m);
+
+	void tick(ev::timer&, int);
+
+	ev::loop_ref loop_;
+	ev::timer ev_tick_;
+
+	dv::callsign name_;
+	udp_engine& io_;
+
+	std::unordered_map<char, module> modules_;
+	std::unordered_map<dv::callsign, gateway> gateways_;// Keyed without module
+	std::unordered_map<dv::callsign, peer> peers_;      // Keyed with module
+	std::unordered_map<uint16_t, char> streams_;
+};
+
+}// namespace dlink
+
+#endif
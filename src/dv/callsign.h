@@ -0,0 +1,206 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#ifndef DV_CALLSIGN_H
+#define DV_CALLSIGN_H
+
+#include <bit>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace dv {
+
+// An 8 character, space padded D-STAR callsign packed into a uint64_t.
+// The bytes are kept in memory order, so loading one from a header field
+// is a single 8 byte copy and comparing two is a single compare.
+class callsign {
+public:
+	static constexpr size_t size = 8;
+
+	constexpr callsign() : v_(blank) {}
+
+	// Copies at most 8 characters and pads the rest with spaces.
+	constexpr callsign(std::string_view s) : v_(blank)
+	{
+		for (size_t i = 0; i < size && i < s.size(); i++)
+			set(i, s[i]);
+	}
+	constexpr callsign(const char* s) : callsign(std::string_view(s)) {}
+	callsign(const std::string& s) : callsign(std::string_view(s)) {}
+
+	// Reads a fixed 8 byte field, such as the ones in dv::header.
+	static callsign from_field(const char* field)
+	{
+		callsign c;
+		std::memcpy(&c.v_, field, size);
+		return c;
+	}
+
+	void to_field(char* field) const
+	{
+		std::memcpy(field, &v_, size);
+	}
+
+	constexpr char operator[](size_t i) const
+	{
+		return static_cast<char>(v_ >> shift(i));
+	}
+
+	// The 8th character: the module for repeaters, or the link command
+	// for URCALL.
+	constexpr char module() const
+	{
+		return (*this)[size - 1];
+	}
+
+	constexpr callsign with_module(char m) const
+	{
+		callsign c = *this;
+		c.set(size - 1, m);
+		return c;
+	}
+
+	// Blanks every character from n onwards.
+	constexpr callsign truncate(size_t n) const
+	{
+		callsign c = *this;
+		for (size_t i = n; i < size; i++)
+			c.set(i, ' ');
+		return c;
+	}
+
+	// The callsign without its module.
+	constexpr callsign base() const
+	{
+		return truncate(size - 1);
+	}
+
+	constexpr callsign upper() const
+	{
+		callsign c = *this;
+		for (size_t i = 0; i < size; i++) {
+			char ch = c[i];
+			if ('a' <= ch && ch <= 'z') c.set(i, ch - 'a' + 'A');
+		}
+		return c;
+	}
+
+	constexpr bool empty() const
+	{
+		return v_ == blank;
+	}
+
+	// Length without trailing spaces.
+	constexpr size_t length() const
+	{
+		size_t n = size;
+		while (n > 0 && (*this)[n - 1] == ' ')
+			n--;
+		return n;
+	}
+
+	constexpr uint64_t value() const
+	{
+		return v_;
+	}
+
+	std::string str() const
+	{
+		std::string s(size, ' ');
+		to_field(s.data());
+		return s;
+	}
+
+	std::string trimmed() const
+	{
+		std::string s = str();
+		s.resize(length());
+		return s;
+	}
+
+	constexpr bool operator==(const callsign&) const = default;
+
+	// Orders like the string would, not like the integer.
+	constexpr std::strong_ordering operator<=>(const callsign& o) const
+	{
+		for (size_t i = 0; i < size; i++) {
+			auto a = static_cast<unsigned char>((*this)[i]);
+			auto b = static_cast<unsigned char>(o[i]);
+			if (a != b) return a <=> b;
+		}
+		return std::strong_ordering::equal;
+	}
+
+private:
+	static constexpr uint64_t blank = 0x2020202020202020ULL;
+
+	static constexpr unsigned shift(size_t i)
+	{
+		return std::endian::native == std::endian::little ? 8 * i : 8 * (size - 1 - i);
+	}
+
+	constexpr void set(size_t i, char ch)
+	{
+		v_ &= ~(0xFFULL << shift(i));
+		v_ |= static_cast<uint64_t>(static_cast<unsigned char>(ch)) << shift(i);
+	}
+
+	uint64_t v_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const callsign& c)
+{
+	char s[callsign::size];
+	c.to_field(s);
+	return os.write(s, callsign::size);
+}
+
+}// namespace dv
+
+template <>
+struct std::hash<dv::callsign> {
+	size_t operator()(const dv::callsign& c) const noexcept
+	{
+		uint64_t v = c.value();
+		return (v ^ (v >> 32)) * 0x9E3779B97F4A7C15ULL;
+	}
+};
+
+#endif
@@ -33,6 +33,7 @@
 //
 
 #include "aprs.h"
+#include "callsign.h"
 #include "crc.h"
 #include "frame.h"
 #include "header.h"
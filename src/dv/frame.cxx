@@ -271,4 +271,42 @@ rf_frame frame::encode() const
 	return f;
 }
 
+std::size_t encode_fastdata(rf_frame out[2], const uint8_t* in, std::size_t len)
+{
+	if (len > fastdata_segment_size) len = fastdata_segment_size;
+
+	uint8_t buf[fastdata_segment_size + 1];
+	std::memset(buf, F_EMPTY, sizeof(buf));
+
+	if (len < 16) buf[0] = F_FASTDATA_1 | len;
+	else buf[0] = F_FASTDATA_2 | (len - 16);
+	std::memcpy(&buf[1], in, len);
+
+	scram_data(out[0].data, &buf[0]);
+	std::memcpy(out[0].ambe, &buf[3], 9);
+	std::memcpy(out[1].ambe, &buf[12], 9);
+	scram_data(out[1].data, &buf[21]);
+
+	return len;
+}
+
+std::size_t decode_fastdata(uint8_t out[fastdata_segment_size], const rf_frame in[2])
+{
+	uint8_t buf[fastdata_segment_size + 1];
+
+	scram_data(&buf[0], in[0].data);
+	if (!is_fastdata(buf[0])) return 0;
+
+	std::size_t len = buf[0] & 0x0FU;
+	if ((buf[0] & 0xF0U) == F_FASTDATA_2) len += 16;
+	if (len > fastdata_segment_size) return 0;
+
+	std::memcpy(&buf[3], in[0].ambe, 9);
+	std::memcpy(&buf[12], in[1].ambe, 9);
+	scram_data(&buf[21], in[1].data);
+
+	std::memcpy(out, &buf[1], len);
+	return len;
+}
+
 }// namespace dv
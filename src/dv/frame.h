@@ -34,6 +34,7 @@
 
 #ifndef DV_FRAME_H
 #define DV_FRAME_H
+#include <cstddef>
 #include <cstdint>
 
 namespace dv {
@@ -103,6 +104,28 @@ static inline constexpr void scram_data(uint8_t out[3], const uint8_t in[3])
 	out[2] = rf_data_scram[2] ^ in[2];
 }
 
+static inline constexpr bool is_fastdata(uint8_t miniheader)
+{
+	return (miniheader & 0xF0U) == F_FASTDATA_1 || (miniheader & 0xF0U) == F_FASTDATA_2;
+}
+
+// Fast data gives up the voice of a segment (two frames) to carry more
+// data. The first frame's miniheader is F_FASTDATA_1 | len for up to 15
+// bytes, or F_FASTDATA_2 | (len - 16) for 16 and up. The payload then
+// fills the rest of the data field of the first frame, the voice field
+// of both frames, and the data field of the second frame. The data
+// fields are scrambled as usual, but the voice fields carry the payload
+// as-is, so they must not be FEC decoded.
+static constexpr std::size_t fastdata_segment_size = 23;
+
+// Fills a segment with up to fastdata_segment_size bytes of data, and
+// returns how many were used.
+std::size_t encode_fastdata(rf_frame out[2], const uint8_t* in, std::size_t len);
+
+// Returns the number of bytes decoded, or 0 if the segment isn't fast
+// data.
+std::size_t decode_fastdata(uint8_t out[fastdata_segment_size], const rf_frame in[2]);
+
 }// namespace dv
 
 #endif
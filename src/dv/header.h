@@ -34,6 +34,7 @@
 
 #ifndef DV_HEADER_H
 #define DV_HEADER_H
+#include "callsign.h"
 #include <cstdint>
 
 namespace dv {
@@ -90,6 +91,12 @@ struct header {
 	bool verify() const;
 
 	rf_header encode() const;
+
+	// RPT2, RPT1, URCALL and MYCALL.
+	callsign destination_rptr() const { return callsign::from_field(destination_rptr_cs); }
+	callsign departure_rptr() const { return callsign::from_field(departure_rptr_cs); }
+	callsign companion() const { return callsign::from_field(companion_cs); }
+	callsign own() const { return callsign::from_field(own_cs); }
 };
 #pragma pack(pop)
 
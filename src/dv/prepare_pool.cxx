@@ -0,0 +1,161 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "prepare_pool.h"
+#include <utility>
+
+namespace dv {
+
+prepare_pool::prepare_pool(unsigned workers, std::size_t max_pending)
+	: max_pending_(max_pending), next_id_(1), stopping_(false)
+{
+	if (workers == 0) workers = 1;
+	for (unsigned i = 0; i < workers; i++) {
+		workers_.emplace_back(&prepare_pool::work, this);
+	}
+}
+
+prepare_pool::~prepare_pool()
+{
+	stop();
+}
+
+std::optional<prepare_pool::job_id> prepare_pool::submit(stream&& s, ev::async* cb)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (stopping_ || pending_.size() >= max_pending_) return {};
+
+	job_id id = next_id_++;
+	pending_.push_back({id, std::move(s), cb});
+	cv_.notify_one();
+
+	return id;
+}
+
+bool prepare_pool::cancel(job_id id)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (auto i = pending_.begin(); i != pending_.end(); ++i) {
+		if (i->id == id) {
+			pending_.erase(i);
+			return true;
+		}
+	}
+
+	auto r = running_.find(id);
+	if (r != running_.end()) {
+		r->second = true;
+		return true;
+	}
+
+	return done_.erase(id) > 0;
+}
+
+std::optional<stream> prepare_pool::take(job_id id)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto i = done_.find(id);
+	if (i == done_.end()) return {};
+
+	stream s = std::move(i->second);
+	done_.erase(i);
+	return s;
+}
+
+void prepare_pool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (stopping_) return;
+		stopping_ = true;
+		pending_.clear();
+	}
+	cv_.notify_all();
+
+	for (auto& t : workers_) t.join();
+	workers_.clear();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	done_.clear();
+}
+
+std::size_t prepare_pool::pending() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return pending_.size();
+}
+
+void prepare_pool::work()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+		cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+		if (stopping_) return;
+
+		job j = std::move(pending_.front());
+		pending_.pop_front();
+		running_[j.id] = false;
+
+		lock.unlock();
+		j.s.prepare();
+		lock.lock();
+
+		bool cancelled = running_[j.id] || stopping_;
+		running_.erase(j.id);
+		if (cancelled) continue;
+
+		done_.emplace(j.id, std::move(j.s));
+
+		// Don't hold the lock while waking the loop up.
+		lock.unlock();
+		if (j.cb != nullptr) j.cb->send();
+		lock.lock();
+	}
+}
+
+prepare_pool& default_prepare_pool()
+{
+	static prepare_pool pool;
+	return pool;
+}
+
+std::optional<uint64_t> stream::prepare_async(ev::async* cb)
+{
+	return default_prepare_pool().submit(std::move(*this), cb);
+}
+
+}// namespace dv
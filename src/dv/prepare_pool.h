@@ -0,0 +1,112 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#ifndef DV_PREPARE_POOL_H
+#define DV_PREPARE_POOL_H
+
+#include "stream.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ev++.h>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+namespace dv {
+
+// Runs stream::prepare() on worker threads so that building a long
+// stream doesn't stall the event loop that asked for it. Streams are
+// moved in, and the finished stream is collected with take() once the
+// given ev::async fires. ev_async_send is safe to call from any thread.
+class prepare_pool {
+public:
+	using job_id = uint64_t;
+
+	prepare_pool(unsigned workers = 1, std::size_t max_pending = 8);
+	prepare_pool(const prepare_pool&) = delete;
+	prepare_pool& operator=(const prepare_pool&) = delete;
+	~prepare_pool();
+
+	// Queue a stream to be prepared. cb may be null if the caller would
+	// rather poll. Returns nothing if the queue is full or the pool has
+	// been stopped.
+	std::optional<job_id> submit(stream&& s, ev::async* cb);
+
+	// Drop a job. A queued job is removed, a running job has its result
+	// discarded, and a finished job that hasn't been taken is freed.
+	// Returns false if the job is unknown.
+	bool cancel(job_id id);
+
+	// Returns the prepared stream if the job has finished.
+	std::optional<stream> take(job_id id);
+
+	// Discards everything queued and joins the workers. Jobs that are
+	// already running are finished, but not delivered.
+	void stop();
+
+	std::size_t pending() const;
+
+private:
+	struct job {
+		job_id id;
+		stream s;
+		ev::async* cb;
+	};
+
+	void work();
+
+	std::size_t max_pending_;
+	job_id next_id_;
+	bool stopping_;
+
+	std::deque<job> pending_;
+	std::unordered_map<job_id, bool> running_;// id -> cancelled
+	std::unordered_map<job_id, stream> done_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::vector<std::thread> workers_;
+};
+
+// The pool used by stream::prepare_async(). It has a single worker, which
+// is enough for echo and announcement playback.
+prepare_pool& default_prepare_pool();
+
+}// namespace dv
+
+#endif
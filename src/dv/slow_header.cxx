@@ -0,0 +1,103 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// !! This file contains snippets of GPL-3 code.
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "slow_header.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dv {
+
+// The crc alone would let through one in 65536 misaligned windows.
+static bool plausible(const header& h)
+{
+	auto first = reinterpret_cast<const uint8_t*>(h.destination_rptr_cs);
+	auto last = reinterpret_cast<const uint8_t*>(h.crc_ccitt);
+	return std::all_of(first, last, [](uint8_t c) { return c >= 0x20U && c < 0x7FU; });
+}
+
+void slow_header::reset()
+{
+	len = 0;
+	miniheader = 0;
+}
+
+bool slow_header::add(uint8_t seqno, const rf_frame& f, header& h)
+{
+	// The sync frame carries no slow data.
+	if (seqno == 0) {
+		miniheader = 0;
+		return false;
+	}
+
+	uint8_t d[3];
+	scram_data(d, f.data);
+
+	const uint8_t* in;
+	size_t n;
+	if (seqno % 2 == 1) {
+		miniheader = d[0];
+		if ((miniheader & 0xF0U) != F_HEADER) return false;
+		in = &d[1];
+		n = std::min(miniheader & 0x0FU, 2U);
+	}
+	else {
+		if ((miniheader & 0xF0U) != F_HEADER) return false;
+		in = &d[0];
+		n = std::min(std::max(miniheader & 0x0FU, 2U) - 2, 3U);
+		miniheader = 0;
+	}
+
+	// Keep the last size - 1 bytes when the buffer fills up.
+	if (len + n > sizeof(buf)) {
+		std::memmove(buf, buf + len - (size - 1), size - 1);
+		len = size - 1;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		buf[len++] = in[i];
+		if (len < size) continue;
+
+		std::memcpy(&h, buf + len - size, size);
+		if (h.verify() && plausible(h)) {
+			reset();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+}// namespace dv
@@ -32,53 +32,35 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
-#ifndef DGATE_THREADED_QUEUE_H
-#define DGATE_THREADED_QUEUE_H
+#ifndef DV_SLOW_HEADER_H
+#define DV_SLOW_HEADER_H
 
-#include <mutex>
-#include <optional>
-#include <queue>
+#include "frame.h"
+#include "header.h"
+#include <cstdint>
 
-template<typename T>
-class threaded_queue {
-public:
-	threaded_queue() = default;
-	threaded_queue(const threaded_queue<T>&) = delete;
-	threaded_queue& operator=(const threaded_queue<T>&) = delete;
+namespace dv {
 
-	threaded_queue(threaded_queue<T>&& other)
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		queue = std::move(other.queue);
-	}
-
-	virtual ~threaded_queue() {}
-
-	typename std::queue<T>::size_type size() const
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		return queue.size();
-	}
-
-	std::optional<T> pop()
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		if (queue.empty()) return {};
+// Radios repeat the header in the slow data of the voice frames, in
+// F_HEADER segments of up to five bytes. This collects those bytes so a
+// receiver that lost the header itself can still pick up the stream.
+//
+// Nothing marks where the header starts, so every 41 byte window is
+// tried against the crc as the bytes come in.
+struct slow_header {
+	static constexpr size_t size = sizeof(header);
 
-		T tmp = queue.front();
-		queue.pop();
-		return tmp;
-	}
+	uint8_t buf[2 * size];
+	uint8_t len;
+	uint8_t miniheader;
 
-	void push(const T& i)
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		queue.push(i);
-	}
+	void reset();
 
-private:
-	std::queue<T> queue;
-	mutable std::mutex mutex;
+	// Adds the frame with sequence number seqno. Returns true once a
+	// header with a valid crc has been found; it is then in h.
+	bool add(uint8_t seqno, const rf_frame& f, header& h);
 };
 
+}// namespace dv
+
 #endif
@@ -34,156 +34,255 @@
 
 #include "stream.h"
 #include "dv/types.h"
+#include <algorithm>
 #include <cstring>
 
 #define MSG 0
 #define SERIAL 1
 namespace dv {
-void stream::prepare()
-{
-	int seqno = 0;
-	bool msg_sent = false;
-	bool serial_sent = false;
-
-	int msg_idx = 0;
-	std::string::size_type serial_idx = 0;
 
-	std::vector<dv::rf_frame>::size_type min_frames = 0;
-
-	if (!tx_msg.empty()) {
-		tx_msg.resize(20, ' ');
+stream_encoder::stream_encoder(const std::string& tx_msg, const std::string& serial_data, std::optional<uint16_t> d_sql)
+	: tx_msg_(tx_msg), serial_data_(serial_data), d_sql_(d_sql), min_frames_(0), count_in_(0), count_mux_(0),
+	  seqno_(0), previous_(SERIAL), msg_idx_(0), serial_idx_(0), msg_sent_(false), serial_sent_(false),
+	  finished_(false), preend_sent_(false), end_sent_(false)
+{
+	if (!tx_msg_.empty()) {
+		tx_msg_.resize(20, ' ');
 		// The tx message requires at least 4 segments.
-		min_frames += 8;
+		min_frames_ += 8;
 	}
 	else {
-		msg_sent = true;
+		msg_sent_ = true;
 	}
 
-	if (!serial_data.empty()) {
+	if (!serial_data_.empty()) {
 		// Every 5 bytes of data needs a segment.
 		// Round up in this case.
-		min_frames += ((serial_data.size() + (5 - 1)) / 5) * 2;
+		min_frames_ += ((serial_data_.size() + (5 - 1)) / 5) * 2;
 	}
 	else {
-		serial_sent = true;
+		serial_sent_ = true;
 	}
 
 	// Every first frame is a sync frame, and thus is unusable.
-	int num_syncs = ((min_frames + (20 - 1)) / 20);
-	if (d_sql) {
+	std::size_t num_syncs = ((min_frames_ + (20 - 1)) / 20);
+	if (d_sql_) {
 		// The code squelch takes up another segment right after the
 		// sync frame.
-		min_frames += num_syncs * 2;
+		min_frames_ += num_syncs * 2;
+	}
+	min_frames_ += num_syncs;
+}
+
+std::optional<rf_frame> stream_encoder::push(const rf_frame& f)
+{
+	if (finished_) return {};
+
+	// We add the ending frames ourselves.
+	if (f.is_end()) {
+		finish();
+		return {};
 	}
-	min_frames += num_syncs;
 
-	// Get rid of ending frames (we will add ourselves.)
-	if (frames.size() > 0 && frames[frames.size() - 1].is_end()) frames.pop_back();
-	std::optional<dv::rf_frame> preend_voice = {};
+	count_in_++;
+
+	std::optional<rf_frame> out = held_;
+	held_ = f;
+	if (out) mux(*out);
+
+	return out;
+}
+
+void stream_encoder::finish()
+{
+	if (finished_) return;
+	finished_ = true;
 
 	// Excluding the sync frame, for these transmissions, we'd like the
 	// length to be a multiple of two for the segments.
-	auto cur_size = frames.size();
-	if (cur_size > min_frames) {
-		cur_size = cur_size % 21;
+	if (count_in_ > min_frames_) {
+		auto cur_size = count_in_ % 21;
 		if (cur_size > 0) cur_size = cur_size - 1;
 		// Uneven number!
 		if (cur_size % 2 == 1) {
 			// Store this voice data for retransmission.
-			preend_voice = frames[frames.size() - 1];
-			frames.pop_back();
+			preend_voice_ = held_;
+			held_.reset();
 		}
 	}
-	else if (cur_size < min_frames) {
-		rf_frame f;
-		std::memcpy(&f.ambe, dv::rf_ambe_null, sizeof(f.ambe));
-		// Add null frames until the minimum is reached.
-		frames.resize(min_frames, f);
-	}
+}
 
-	int previous = 1;// 0 is for message, 1 is for serial
+std::optional<rf_frame> stream_encoder::next()
+{
+	if (!finished_) return {};
 
-	uint8_t buf[3];
-	std::vector<dv::rf_frame>::size_type i;
-	for (i = 0; i < frames.size(); i++) {
-		if (seqno == 0) {
-			std::memcpy(frames[i].data, rf_data_sync, 3);
-		}
+	rf_frame f;
 
-		else if (d_sql && seqno == 1) {
-			buf[0] = F_DSQL | 0x02U;
-			buf[1] = *d_sql & 0xFFU;
-			buf[2] = (*d_sql >> 8) & 0xFFU;
-			dv::scram_data(frames[i].data, buf);
+	if (held_ || count_mux_ < min_frames_) {
+		if (held_) {
+			f = *held_;
+			held_.reset();
 		}
-
-		else if (d_sql && seqno == 2) {
-			std::memcpy(frames[i].data, rf_data_null, 3);
+		else {
+			// Add null frames until the minimum is reached.
+			std::memcpy(f.ambe, rf_ambe_null, 9);
+			std::memcpy(f.data, rf_data_null, 3);
 		}
+		mux(f);
 
-		else if (seqno % 2 == 1) {
-			if (!serial_sent && (msg_sent || previous == MSG)) {
-				uint8_t tosend = std::min<std::string::size_type>(serial_data.size() - serial_idx, 5);
-				buf[0] = F_DATA | (tosend & 0x0FU);
-				buf[1] = serial_data[serial_idx];
-				buf[2] = (tosend > 1 ? serial_data[serial_idx + 1] : 0x66U);
-				dv::scram_data(frames[i].data, buf);
-			}
-			else if (!tx_msg.empty() && (serial_sent || previous == SERIAL)) {
-				buf[0] = F_TXMSG | msg_idx;
-				buf[1] = tx_msg[msg_idx * 5];
-				buf[2] = tx_msg[msg_idx * 5 + 1];
-				dv::scram_data(frames[i].data, buf);
-			}
-		}
-		else {
-			if (!serial_sent && (msg_sent || previous == MSG)) {
-				uint8_t tosend = std::min<std::string::size_type>(serial_data.size() - serial_idx, 5);
-				buf[0] = (tosend > 2 ? serial_data[serial_idx + 2] : 0x66U);
-				buf[1] = (tosend > 3 ? serial_data[serial_idx + 3] : 0x66U);
-				buf[2] = (tosend > 4 ? serial_data[serial_idx + 4] : 0x66U);
-				dv::scram_data(frames[i].data, buf);
-				serial_idx += tosend;
-				if (serial_idx >= serial_data.size()) serial_sent = true;
-				previous = SERIAL;
-			}
-			else if (!tx_msg.empty() && (serial_sent || previous == SERIAL)) {
-				buf[0] = tx_msg[msg_idx * 5 + 2];
-				buf[1] = tx_msg[msg_idx * 5 + 3];
-				buf[2] = tx_msg[msg_idx * 5 + 4];
-				dv::scram_data(frames[i].data, buf);
-				msg_idx++;
-				if (msg_idx == 4) {
-					msg_sent = true;
-					msg_idx = 0;
-				}
-				previous = MSG;
-			}
+		// If the last frame ended up being a sync frame, it can be
+		// used as the pre-end frame.
+		bool last = !held_ && count_mux_ >= min_frames_;
+		if (last && !preend_voice_ && f.is_sync()) {
+			std::memcpy(f.data, rf_data_preend, 3);
+			preend_sent_ = true;
 		}
+		return f;
+	}
 
-		seqno = (seqno + 1) % 21;
+	if (!preend_sent_) {
+		std::memcpy(f.ambe, preend_voice_ ? preend_voice_->ambe : rf_ambe_null, 9);
+		std::memcpy(f.data, rf_data_preend, 3);
+		preend_sent_ = true;
+		return f;
 	}
 
-	dv::rf_frame f;
-	// Add ending frames
-	std::memcpy(f.data, dv::rf_data_preend, 3);
-	if (preend_voice) {
-		std::memcpy(f.ambe, preend_voice->ambe, 9);
-		frames.push_back(f);
+	if (!end_sent_) {
+		std::memcpy(f.ambe, rf_ambe_end, 9);
+		f.data[0] = 0;
+		f.data[1] = 0;
+		f.data[2] = 0;
+		end_sent_ = true;
+		return f;
 	}
-	else if (frames[frames.size() - 1].is_sync()) {
-		std::memcpy(frames[frames.size() - 1].data, dv::rf_data_preend, 3);
+
+	return {};
+}
+
+bool stream_encoder::done() const
+{
+	return end_sent_;
+}
+
+void stream_encoder::mux(rf_frame& f)
+{
+	uint8_t buf[3];
+
+	if (seqno_ == 0) {
+		std::memcpy(f.data, rf_data_sync, 3);
+	}
+
+	else if (d_sql_ && seqno_ == 1) {
+		buf[0] = F_DSQL | 0x02U;
+		buf[1] = *d_sql_ & 0xFFU;
+		buf[2] = (*d_sql_ >> 8) & 0xFFU;
+		scram_data(f.data, buf);
+	}
+
+	else if (d_sql_ && seqno_ == 2) {
+		std::memcpy(f.data, rf_data_null, 3);
+	}
+
+	else if (seqno_ % 2 == 1) {
+		if (!serial_sent_ && (msg_sent_ || previous_ == MSG)) {
+			uint8_t tosend = std::min<std::string::size_type>(serial_data_.size() - serial_idx_, 5);
+			buf[0] = F_DATA | (tosend & 0x0FU);
+			buf[1] = serial_data_[serial_idx_];
+			buf[2] = (tosend > 1 ? serial_data_[serial_idx_ + 1] : 0x66U);
+			scram_data(f.data, buf);
+		}
+		else if (!tx_msg_.empty() && (serial_sent_ || previous_ == SERIAL)) {
+			buf[0] = F_TXMSG | msg_idx_;
+			buf[1] = tx_msg_[msg_idx_ * 5];
+			buf[2] = tx_msg_[msg_idx_ * 5 + 1];
+			scram_data(f.data, buf);
+		}
 	}
 	else {
-		std::memcpy(f.ambe, dv::rf_ambe_null, 9);
-		frames.push_back(f);
+		if (!serial_sent_ && (msg_sent_ || previous_ == MSG)) {
+			uint8_t tosend = std::min<std::string::size_type>(serial_data_.size() - serial_idx_, 5);
+			buf[0] = (tosend > 2 ? serial_data_[serial_idx_ + 2] : 0x66U);
+			buf[1] = (tosend > 3 ? serial_data_[serial_idx_ + 3] : 0x66U);
+			buf[2] = (tosend > 4 ? serial_data_[serial_idx_ + 4] : 0x66U);
+			scram_data(f.data, buf);
+			serial_idx_ += tosend;
+			if (serial_idx_ >= serial_data_.size()) serial_sent_ = true;
+			previous_ = SERIAL;
+		}
+		else if (!tx_msg_.empty() && (serial_sent_ || previous_ == SERIAL)) {
+			buf[0] = tx_msg_[msg_idx_ * 5 + 2];
+			buf[1] = tx_msg_[msg_idx_ * 5 + 3];
+			buf[2] = tx_msg_[msg_idx_ * 5 + 4];
+			scram_data(f.data, buf);
+			msg_idx_++;
+			if (msg_idx_ == 4) {
+				msg_sent_ = true;
+				msg_idx_ = 0;
+			}
+			previous_ = MSG;
+		}
 	}
 
-	std::memcpy(f.ambe, dv::rf_ambe_end, 9);
+	seqno_ = (seqno_ + 1) % 21;
+	count_mux_++;
+}
+
+static void prepare_fast_data(std::vector<rf_frame>& frames, const std::string& data)
+{
+	frames.clear();
+	frames.reserve((data.size() / fastdata_segment_size + 1) * 21 / 10 + 4);
+
+	auto in = reinterpret_cast<const uint8_t*>(data.data());
+	std::string::size_type i = 0;
+	while (i < data.size()) {
+		if (frames.size() % 21 == 0) {
+			rf_frame f;
+			std::memcpy(f.ambe, rf_ambe_null, 9);
+			std::memcpy(f.data, rf_data_sync, 3);
+			frames.push_back(f);
+			continue;
+		}
+
+		rf_frame seg[2];
+		i += encode_fastdata(seg, in + i, data.size() - i);
+		frames.push_back(seg[0]);
+		frames.push_back(seg[1]);
+	}
+
+	rf_frame f;
+	std::memcpy(f.ambe, rf_ambe_null, 9);
+	std::memcpy(f.data, rf_data_preend, 3);
+	frames.push_back(f);
+
+	std::memcpy(f.ambe, rf_ambe_end, 9);
 	f.data[0] = 0;
 	f.data[1] = 0;
 	f.data[2] = 0;
 	frames.push_back(f);
+}
+
+void stream::prepare()
+{
+	if (!fast_data.empty()) {
+		prepare_fast_data(frames, fast_data);
+		return;
+	}
+
+	if (!tx_msg.empty()) tx_msg.resize(20, ' ');
+
+	stream_encoder enc(tx_msg, serial_data, d_sql);
+
+	std::vector<dv::rf_frame> out;
+	out.reserve(frames.size() + 2);
+
+	for (const auto& f : frames) {
+		if (auto r = enc.push(f)) out.push_back(*r);
+	}
+
+	enc.finish();
+	while (auto r = enc.next()) out.push_back(*r);
+
+	frames = std::move(out);
 
 	// Done!
 }
@@ -39,9 +39,57 @@
 #include "header.h"
 #include <ev++.h>
 #include <optional>
+#include <string>
 #include <vector>
 namespace dv {
 
+// Multiplexes the slow data of a transmission (sync, digital squelch, TX
+// message and serial data) into voice frames one at a time. Input can
+// come from anywhere, and nothing is kept besides the slow data itself,
+// so memory doesn't grow with the length of the transmission.
+//
+// The last voice frame of a transmission may be reused for the pre-end
+// frame, so output lags input by one frame.
+class stream_encoder {
+public:
+	stream_encoder(const std::string& tx_msg, const std::string& serial_data, std::optional<uint16_t> d_sql);
+
+	// Feeds the next voice frame in, and returns the next encoded frame
+	// if one is ready. An end frame finishes the stream.
+	std::optional<rf_frame> push(const rf_frame& f);
+
+	// Marks the end of input. The remaining frames (padding, pre-end,
+	// end) are pulled with next().
+	void finish();
+	std::optional<rf_frame> next();
+
+	bool done() const;
+
+private:
+	void mux(rf_frame& f);
+
+	std::string tx_msg_;
+	std::string serial_data_;
+	std::optional<uint16_t> d_sql_;
+
+	std::size_t min_frames_;
+	std::size_t count_in_; // Voice frames pushed in
+	std::size_t count_mux_;// Frames passed through mux()
+
+	int seqno_;
+	int previous_;
+	int msg_idx_;
+	std::string::size_type serial_idx_;
+	bool msg_sent_;
+	bool serial_sent_;
+
+	std::optional<rf_frame> held_;
+	std::optional<rf_frame> preend_voice_;
+	bool finished_;
+	bool preend_sent_;
+	bool end_sent_;
+};
+
 struct stream {
 	dv::header header;
 	std::vector<dv::rf_frame> frames;
@@ -51,8 +99,18 @@ struct stream {
 
 	std::optional<uint16_t> d_sql;// digital squelch
 
+	// If not empty, prepare() builds the frames from this data sent as
+	// fast data, and the voice frames, tx_msg and serial_data are not
+	// used.
+	std::string fast_data;
+
 	void prepare();
-	void prepare_async(ev::async* cb);
+
+	// Moves this stream into the default prepare_pool, and fires cb once
+	// it has been prepared. The result is collected with
+	// default_prepare_pool().take() using the returned id. Returns
+	// nothing if the pool is full.
+	std::optional<uint64_t> prepare_async(ev::async* cb);
 };
 
 }// namespace dv
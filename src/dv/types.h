@@ -32,5 +32,6 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#include "callsign.h"
 #include "frame.h"
 #include "header.h"
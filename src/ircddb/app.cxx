@@ -21,6 +21,7 @@
 
 #include "app.h"
 #include "ircddb/client.h"
+#include "ircddb/records.h"
 #include <algorithm>
 #include <cctype>
 #include <future>
@@ -35,46 +36,60 @@ std::string str_tolower(std::string s)
 	return s;
 }
 
-std::string str_toupper(std::string s)
+dv::callsign name_to_zone(std::string_view name)
 {
-	std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
-	return s;
-}
-
-std::string name_to_zone(const std::string& name)
-{
-	auto upper = str_toupper(name);
-	upper.resize(7, ' ');
-	return upper;
+	return dv::callsign(name).upper().base();
 }
 
 namespace ircddb {
 
-app::app(const std::string& dgate_socket_path, const std::string& cs, std::unordered_set<char> enabled_mods_, const std::vector<client_cfg>& configs, std::shared_ptr<lmdb::env> env, std::shared_ptr<lmdb::dbi> cs_rptr, std::shared_ptr<lmdb::dbi> zone_ip4, std::shared_ptr<lmdb::dbi> zone_ip6, std::shared_ptr<lmdb::dbi> zone_nick)
-	: dgate::client(dgate_socket_path), done(false), error(false), ev_msg_out(loop_), env_(env), cs_rptr_(cs_rptr), zone_ip4_(zone_ip4), zone_ip6_(zone_ip6), zone_nick_(zone_nick)
+app::app(const std::string& dgate_socket_path, const std::string& cs, std::unordered_set<char> enabled_mods_, const std::vector<client_cfg>& configs, std::shared_ptr<lmdb::env> env, std::shared_ptr<lmdb::dbi> cs_rptr, std::shared_ptr<lmdb::dbi> zone_ip4, std::shared_ptr<lmdb::dbi> zone_ip6, std::shared_ptr<lmdb::dbi> zone_nick, std::shared_ptr<lmdb::dbi> irc_sync)
+	: dgate::client(dgate_socket_path), done(false), error(false), ev_msg_out(loop_), env_(env), writer_(env), cs_rptr_(cs_rptr), zone_ip4_(zone_ip4), zone_ip6_(zone_ip6), zone_nick_(zone_nick), irc_sync_(irc_sync)
 {
 	cs_ = str_tolower(cs);
 
+	route_policy policy;
+	for (const auto& c : configs)
+		policy.server_rank.push_back(c.priority);
+	routes_.set_policy(policy);
+	writer_.put(irc_sync_, std::string(route_policy_key), policy.encode());
+
+	// Start from what the last run learned, and make each commit visible
+	// to lookups.
+	routes_.rebuild(*env_, *zone_ip4_, *zone_ip6_);
+	writer_.on_commit([this](uint64_t mark) { routes_.publish(mark); });
+	writer_.on_drop([this](uint64_t mark) { routes_.discard(mark); });
+
 	// TODO: verify realname field
 	std::string realname = ":CIRCDDB: dgate 0.0.1";
 
 	for (const auto& c : configs) {
 		auto store = std::make_shared<client_store>();
 
-		store->watcher = std::make_shared<ev::async>(loop_);
-		store->watcher->set<app, &app::msg_in>(this);
-		store->watcher->start();
-
 		store->current_nick = cs_ + "-1";
 
-		store->client = std::make_unique<ircddb::client>(c.host, c.port, c.pass, store->current_nick, cs_, "CIRCDDB:2.0.0 d-gate0001", store->watcher);
+		if (c.own_thread) {
+			store->watcher = std::make_shared<ev::async>(loop_);
+			store->watcher->set<app, &app::msg_in>(this);
+			store->watcher->start();
+
+			store->client = std::make_unique<ircddb::client>(c.host, c.port, c.pass, store->current_nick, cs_, "CIRCDDB:2.0.0 d-gate0001", store->watcher);
+		}
+		else {
+			int i = clients_.size();
+			store->client = std::make_unique<ircddb::client>(loop_, c.host, c.port, c.pass, store->current_nick, cs_, "CIRCDDB:2.0.0 d-gate0001", [this, i](const irc_msg_view& msg) { handle_msg(i, msg); });
+		}
 		store->cfg = c;
+		store->sync_key = c.host + ":" + std::to_string(c.port);
 
 		clients_.push_back(std::move(store));
 	}
 
+	load_sync_state();
+
 	ev_msg_out.set<app, &app::msg_out>(this);
 	ev_msg_out.start();
+	queue_msg_out.set_signal(&ev_msg_out);
 }
 
 // This should run on a separate thread
@@ -85,6 +100,10 @@ void app::run()
 	std::vector<std::future<void>> futures;
 
 	for (const auto& c : clients_) {
+		if (!c->cfg.own_thread) {
+			c->client->connect();
+			continue;
+		}
 		c->watcher->start();
 		auto future = std::async(std::launch::async, [=]() {
 			if (!c->client->connect())
@@ -99,22 +118,25 @@ void app::run()
 void app::do_cleanup()
 {
 	for (const auto& c : clients_) {
-		c->watcher->stop();
+		if (c->watcher) c->watcher->stop();
 	}
+
+	// Commit whatever is still batched before the process goes away.
+	writer_.stop();
+	std::cout << "ircddb: " << writer_.records() << " gate records in " << writer_.commits() << " commits" << std::endl;
 }
 
 void app::queue_msg(const irc_msg& msg)
 {
-	queue_msg_out.push(msg);
-	ev_msg_out.send();
+	if (!queue_msg_out.push(irc_msg(msg)))
+		std::cerr << "ircddb: outgoing queue full, dropping: " << msg;
 }
 
 void app::msg_out(ev::async&, int)
 {
 	// Use the prefix to determine which server to send to.
 	// Normally we don't wanna send outgoing prefixes to the server.
-	while (auto m = queue_msg_out.pop()) {
-		auto msg = *m;
+	queue_msg_out.drain([this](irc_msg& msg) {
 		if (msg.prefix) {
 			int i;
 			try {
@@ -142,26 +164,26 @@ void app::msg_out(ev::async&, int)
 		if (msg.command == "QUIT") {
 			cleanup();
 		}
-	}
+	});
 }
 
 void app::msg_in(ev::async& watcher, int)
 {
 	for (std::vector<client_store>::size_type i = 0; i < clients_.size(); i++) {
 		if (clients_[i]->watcher.get() == &watcher) {
-			while (auto msg = clients_[i]->client->queue_msg_in.pop()) {
-				handle_msg(i, *msg);
-			}
+			irc_msg_view msg;
+			clients_[i]->client->queue_msg_in.drain([&](const std::string& line) {
+				if (msg.parse(line)) handle_msg(i, msg);
+			});
+			clients_[i]->client->resume();
 		}
 	}
 }
 
-void app::handle_msg(int i, const irc_msg& msg)
+void app::handle_msg(int i, const irc_msg_view& msg)
 {
-	//std::cout << msg;
 	if (msg.code) {
-		auto c = *msg.code;
-		switch (c) {
+		switch (msg.code) {
 		case irc::RPL_WELCOME:
 			clients_[i]->client->queue_msg(irc_msg("JOIN", {}, clients_[i]->cfg.update_channel));
 			break;
@@ -171,6 +193,10 @@ void app::handle_msg(int i, const irc_msg& msg)
 		case irc::RPL_WHOREPLY:
 			handle_WHOREPLY(i, msg);
 			break;
+		case irc::RPL_ENDOFWHO:
+			clients_[i]->last_full_sync = std::time(nullptr);
+			persist_sync(i);
+			break;
 		}
 	}
 	else if (msg.command == "JOIN") {
@@ -183,11 +209,11 @@ void app::handle_msg(int i, const irc_msg& msg)
 
 static const std::regex SERVOPER_NICK_REGEX("@(s-[A-Za-z0-9\\x5B-\\x60\\x7B-\\x7D]+)", std::regex_constants::ECMAScript | std::regex_constants::optimize);
 
-void app::handle_NAMREPLY(int i, const irc_msg& msg)
+void app::handle_NAMREPLY(int i, const irc_msg_view& msg)
 {
 	// We might be able to get the "server user" here.
-	std::smatch match;
-	if (msg.params && msg.params->trailer && std::regex_search(*msg.params->trailer, match, SERVOPER_NICK_REGEX)) {
+	std::match_results<std::string_view::const_iterator> match;
+	if (msg.has_trailer && std::regex_search(msg.trailer.begin(), msg.trailer.end(), match, SERVOPER_NICK_REGEX)) {
 		clients_[i]->server_nick = match[1];
 		std::cout << "server user recognized as " << clients_[i]->server_nick << std::endl;
 	}
@@ -195,42 +221,85 @@ void app::handle_NAMREPLY(int i, const irc_msg& msg)
 
 static const std::regex GATE_NICK_REGEX("^[A-Za-z0-9]+-[0-9]$", std::regex_constants::ECMAScript | std::regex_constants::optimize);
 
+// Whether the message comes from a gateway's nick, like "ko6jxh-1".
+static bool is_gate(const irc_msg_view& msg)
+{
+	return !msg.nick.empty() && !msg.host.empty() && !msg.user.empty() && !msg.nick.starts_with("u-") && std::regex_match(msg.nick.begin(), msg.nick.end(), GATE_NICK_REGEX);
+}
+
 // TODO: if server user leaves and rejoins, or changes name, update the
 // server user.
-void app::handle_JOIN(int i, const irc_msg& msg)
+void app::handle_JOIN(int i, const irc_msg_view& msg)
 {
-	if (msg.params && *msg.params->trailer == clients_[i]->cfg.update_channel) {
-		if (msg.pfx && msg.pfx->nick && *msg.pfx->nick == clients_[i]->current_nick) {
+	if (msg.has_trailer && msg.trailer == clients_[i]->cfg.update_channel) {
+		if (msg.nick == clients_[i]->current_nick) {
 			std::cout << "Joined to update channel" << std::endl;
 
-			get_all_gates(i);
+			// The routes loaded at startup are good enough if we
+			// haven't been away long; JOIN and QUIT keep them current.
+			auto now = std::time(nullptr);
+			if (snapshot_fresh(i, now))
+				std::cout << "ircddb: warm start from a " << now - clients_[i]->last_update << " s old snapshot" << std::endl;
+			else
+				get_all_gates(i);
 		}
-		else if (msg.pfx) {
-			auto nick = msg.pfx->nick;
-			auto host = msg.pfx->host;
-			auto user = msg.pfx->user;
-			if (nick && host && user && !nick->starts_with("u-") && std::regex_match(*nick, GATE_NICK_REGEX))
-				update_gate(i, *nick, *user, *host);
+		else if (is_gate(msg)) {
+			update_gate(i, msg.nick, msg.user, msg.host);
 		}
 	}
 }
 
-void app::handle_WHOREPLY(int i, const irc_msg& msg)
+void app::handle_WHOREPLY(int i, const irc_msg_view& msg)
 {
-	if (!msg.params) return;
-
-	auto p = *msg.params;
-	if (p.list.size() < 6) return;
-	if (p.list[1] != clients_[i]->cfg.update_channel) return;
-	if (std::regex_match(p.list[5], GATE_NICK_REGEX)) {
-		update_gate(i, p.list[5], p.list[2], p.list[3]);
+	auto p = msg.params;
+	if (msg.param_count < 6) return;
+	if (p[1] != clients_[i]->cfg.update_channel) return;
+	if (std::regex_match(p[5].begin(), p[5].end(), GATE_NICK_REGEX)) {
+		update_gate(i, p[5], p[2], p[3]);
 	}
-	else if (p.list.size() > 6 && p.list[5].starts_with("s-") && p.list[6].ends_with('@')) {
-		clients_[i]->server_nick = p.list[5];
+	else if (msg.param_count > 6 && p[5].starts_with("s-") && p[6].ends_with('@')) {
+		clients_[i]->server_nick = p[5];
 		std::cout << "server user recognized as " << clients_[i]->server_nick << std::endl;
 	}
 }
 
+void app::load_sync_state()
+{
+	auto rtxn = lmdb::txn::begin(*env_, nullptr, MDB_RDONLY);
+	for (auto& c : clients_) {
+		auto r = irc_sync_->get_as<sync_record>(rtxn, c->sync_key);
+		if (!r) continue;
+		c->last_update = c->last_persisted = r->last_update();
+		c->last_full_sync = r->last_full_sync();
+	}
+	rtxn.abort();
+}
+
+bool app::snapshot_fresh(int i, std::time_t now) const
+{
+	const auto& c = clients_[i];
+	return ircddb::snapshot_fresh(c->last_update, c->last_full_sync, now);
+}
+
+// Notes that server i told us something at now. Persisted at most once a
+// second; the record rides along in the writer's batch.
+void app::touch(int i, std::time_t now)
+{
+	auto& c = clients_[i];
+	c->last_update = now;
+	if (c->last_persisted != now) persist_sync(i);
+}
+
+void app::persist_sync(int i)
+{
+	auto& c = clients_[i];
+	sync_record r;
+	store_time(r.updated, c->last_update);
+	store_time(r.full_sync, c->last_full_sync);
+	c->last_persisted = c->last_update;
+	writer_.put(irc_sync_, c->sync_key, std::string(lmdb::to_sv(r)));
+}
+
 // Send a WHO #dstar :* command to initialize mappings from GATE -> IP.
 void app::get_all_gates(int i)
 {
@@ -238,48 +307,56 @@ void app::get_all_gates(int i)
 	clients_[i]->client->queue_msg(who);
 }
 
-// Update the memory-cache and insert a new GATE.
-void app::update_gate(int i, const std::string& nick, const std::string& name, const std::string& host)
+// Update the memory-cache and insert a new GATE. The write is batched by
+// writer_ and lands on disk within its commit delay.
+void app::update_gate(int i, std::string_view nick, std::string_view name, std::string_view host)
 {
 	auto now = std::time(nullptr);
 
-	// Normalize to 7 character string
+	// Normalize to 7 characters
 	auto zone = name_to_zone(name);
+	auto af = clients_[i]->cfg.af;
 
-	auto wtxn = lmdb::txn::begin(*env_);
-
-	zone_nick_->put(wtxn, std::to_string(i) + " " + zone, nick);
-	if (clients_[i]->cfg.af == AF_INET) {
-		zone_ip4_->put(wtxn, zone, std::to_string(i) + " " + std::to_string(now) + " " + host);
+	gate_addr addr;
+	if (!addr.set(i, now, af, host)) {
+		std::cerr << "ircddb: " << nick << " has no usable address: " << host << std::endl;
+		return;
 	}
-	else {
-		zone_ip6_->put(wtxn, zone, std::to_string(i) + " " + std::to_string(now) + " " + host);
+	touch(i, now);
+
+	// The nick row is always written: a QUIT may have removed it while
+	// the address stayed.
+	writer_.put(zone_nick_, std::string(lmdb::to_sv(nick_key::make(zone, i))), std::string(nick));
+
+	// Skip the address the snapshot already has, unless it is getting old.
+	auto known = routes_.lookup(zone, now);
+	for (std::size_t n = 0; n < known.count; n++) {
+		const auto& r = known.routes[n];
+		if (r.server == i && r.af == af && std::equal(r.addr.begin(), r.addr.end(), addr.addr) && now - r.updated < refresh_interval)
+			return;
 	}
 
-	wtxn.commit();
+	// The route change goes live with the batch that commits the
+	// address, and is thrown away if that batch is dropped.
+	routes_.set(zone, af, addr);
+	writer_.replace_dup(af == AF_INET ? zone_ip4_ : zone_ip6_, std::string(lmdb::to_sv(zone_key::make(zone))), std::string(lmdb::to_sv(addr)), sizeof(addr.server), routes_.mark());
 }
 
 // Deletes a "zone/IRC server" -> "nick" mapping.
 // We don't delete the IP entry because it could be from a different IRC
 // server.
-void app::delete_gate(int i, const std::string& name)
+void app::delete_gate(int i, std::string_view name)
 {
 	auto zone = name_to_zone(name);
 
-	auto wtxn = lmdb::txn::begin(*env_);
-	zone_nick_->del(wtxn, std::to_string(i) + " " + zone);
-	wtxn.commit();
+	touch(i, std::time(nullptr));
+	writer_.del(zone_nick_, std::string(lmdb::to_sv(nick_key::make(zone, i))));
 }
 
-void app::handle_QUIT(int i, const irc_msg& msg)
+void app::handle_QUIT(int i, const irc_msg_view& msg)
 {
-	if (msg.params && *msg.params->trailer == clients_[i]->cfg.update_channel && msg.pfx) {
-		auto nick = msg.pfx->nick;
-		auto host = msg.pfx->host;
-		auto user = msg.pfx->user;
-		if (nick && host && user && !nick->starts_with("u-") && std::regex_match(*nick, GATE_NICK_REGEX))
-			delete_gate(i, *user);
-	}
+	if (msg.has_trailer && msg.trailer == clients_[i]->cfg.update_channel && is_gate(msg))
+		delete_gate(i, msg.user);
 }
 
 }// namespace ircddb
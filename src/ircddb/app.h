@@ -22,12 +22,15 @@
 #ifndef IRCDDB_APP_H
 #define IRCDDB_APP_H
 #include "client.h"
-#include "common/threaded_queue.h"
+#include "common/ring_queue.h"
 #include "common/lmdb++.h"
 #include "dgate/client.h"
+#include "gate_writer.h"
+#include "route_cache.h"
 #include "irc_msg.h"
 #include <atomic>
 #include <cstdint>
+#include <ctime>
 #include <ev++.h>
 #include <map>
 #include <memory>
@@ -43,6 +46,11 @@ struct client_cfg {
 	std::string update_channel;
 	uint_least16_t port;
 	uint_least16_t af;// address family of IPs on the irc server
+	// Lower is preferred when servers disagree about a gate.
+	int priority = 0;
+	// Run this server on its own thread and loop instead of the app's,
+	// for when its traffic is heavy enough to get in the way.
+	bool own_thread = false;
 };
 
 struct client_store {
@@ -52,6 +60,12 @@ struct client_store {
 	std::map<std::string, std::string> gate_nick;
 	std::string server_nick;
 	std::string current_nick;
+
+	// irc_sync state for this server.
+	std::string sync_key;
+	std::time_t last_update = 0;
+	std::time_t last_full_sync = 0;
+	std::time_t last_persisted = 0;
 };
 
 class app : public dgate::client {
@@ -61,7 +75,8 @@ public:
 	    std::shared_ptr<lmdb::dbi> cs_rptr,
 	    std::shared_ptr<lmdb::dbi> zone_ip4,
 	    std::shared_ptr<lmdb::dbi> zone_ip6,
-	    std::shared_ptr<lmdb::dbi> zone_nick);
+	    std::shared_ptr<lmdb::dbi> zone_nick,
+	    std::shared_ptr<lmdb::dbi> irc_sync);
 	void run();
 
 	std::atomic_bool done;
@@ -70,6 +85,8 @@ public:
 
 	void queue_msg(const irc_msg& msg);
 
+	const route_cache& routes() const { return routes_; }
+
 protected:
 	void do_setup() override;
 	void do_cleanup() override;
@@ -82,32 +99,45 @@ private:
 	void msg_out(ev::async& w, int revents);
 	void msg_in(ev::async& w, int revents);
 
-	void handle_msg(int id, const irc_msg& msg);
+	void handle_msg(int id, const irc_msg_view& msg);
 
-	void handle_NAMREPLY(int id, const irc_msg& msg);
-	void handle_WHOREPLY(int id, const irc_msg& msg);
-	void handle_JOIN(int id, const irc_msg& msg);
-	void handle_QUIT(int id, const irc_msg& msg);
+	void handle_NAMREPLY(int id, const irc_msg_view& msg);
+	void handle_WHOREPLY(int id, const irc_msg_view& msg);
+	void handle_JOIN(int id, const irc_msg_view& msg);
+	void handle_QUIT(int id, const irc_msg_view& msg);
 
-	void update_gate(int client, const std::string& nick, const std::string& user, const std::string& host);
-	void delete_gate(int client, const std::string& user);
+	void update_gate(int client, std::string_view nick, std::string_view user, std::string_view host);
+	void delete_gate(int client, std::string_view user);
 
 	void get_all_gates(int client);
 
+	// An unchanged gate is rewritten at most this often.
+	static constexpr std::time_t refresh_interval = 5 * 60;
+
+	void load_sync_state();
+	bool snapshot_fresh(int client, std::time_t now) const;
+	void touch(int client, std::time_t now);
+	void persist_sync(int client);
+
 	std::string cs_;
 
 	std::vector<std::shared_ptr<client_store>> clients_;
 
 	// Fired when message added to queue.
 	ev::async ev_msg_out;
-	threaded_queue<irc_msg> queue_msg_out;
+	// Any thread may queue_msg().
+	signalled_queue<mpsc_queue<irc_msg, 1024>> queue_msg_out;
 
 	// Used for caching heard callsigns.
 	std::shared_ptr<lmdb::env> env_;
+	// Declared before writer_, whose thread publishes to it.
+	route_cache routes_;
+	gate_writer writer_;
 	std::shared_ptr<lmdb::dbi> cs_rptr_;
 	std::shared_ptr<lmdb::dbi> zone_ip4_;
 	std::shared_ptr<lmdb::dbi> zone_ip6_;
 	std::shared_ptr<lmdb::dbi> zone_nick_;
+	std::shared_ptr<lmdb::dbi> irc_sync_;
 };
 
 }// namespace ircddb
@@ -29,14 +29,26 @@
 #include <ios>
 #include <iostream>
 #include <netdb.h>
-#include <sstream>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
 namespace ircddb {
 
 client::client(const std::string& host, const uint_least16_t port, const std::string& pass, const std::string& nick, const std::string& user, const std::string& realname, std::shared_ptr<ev::async> ev_msg_in_callback)
-	: loop_(), ev_sock_readable_(loop_), ev_sock_writable_(loop_), ev_sock_timeout_(loop_), ev_msg_out_(loop_), ev_msg_in_callback_(ev_msg_in_callback), host_(host), port_(port), pass_(pass), nick_(nick), user_(user), realname_(realname)
+	: state(CLOSED), own_loop_(std::make_unique<ev::dynamic_loop>()), loop_(*own_loop_), ev_sock_readable_(loop_), ev_sock_writable_(loop_), ev_sock_timeout_(loop_), ev_msg_out_(loop_), ev_resume_(loop_), ev_msg_in_callback_(ev_msg_in_callback), host_(host), port_(port), pass_(pass), nick_(nick), user_(user), realname_(realname), socketFd_(-1)
+{
+	ev_sock_readable_.set<client, &client::readable>(this);
+	ev_sock_writable_.set<client, &client::writable>(this);
+	ev_sock_timeout_.set<client, &client::timeout>(this);
+	ev_msg_out_.set<client, &client::msg_out>(this);
+	ev_resume_.set<client, &client::resumed>(this);
+	queue_msg_in.set_signal(ev_msg_in_callback_.get());
+	queue_msg_out_.set_signal(&ev_msg_out_);
+}
+
+client::client(ev::loop_ref loop, const std::string& host, const uint_least16_t port, const std::string& pass, const std::string& nick, const std::string& user, const std::string& realname, handler on_msg)
+	: state(CLOSED), loop_(loop), ev_sock_readable_(loop_), ev_sock_writable_(loop_), ev_sock_timeout_(loop_), ev_msg_out_(loop_), ev_resume_(loop_), on_msg_(std::move(on_msg)), host_(host), port_(port), pass_(pass), nick_(nick), user_(user), realname_(realname), socketFd_(-1)
 {
 	ev_sock_readable_.set<client, &client::readable>(this);
 	ev_sock_writable_.set<client, &client::writable>(this);
@@ -46,7 +58,7 @@ client::client(const std::string& host, const uint_least16_t port, const std::st
 
 void client::run()
 {
-	loop_.run();
+	if (own_loop_) own_loop_->run();
 };
 
 int client::connect()
@@ -95,9 +107,13 @@ int client::connect()
 	ev_sock_writable_.set(socketFd_, ev::WRITE);
 	ev_sock_readable_.set(socketFd_, ev::READ);
 
+	paused_ = false;
 	ev_sock_readable_.start();
 	ev_sock_timeout_.start(45., 45.);
-	ev_msg_out_.start();
+	if (own_loop_) {
+		ev_msg_out_.start();
+		ev_resume_.start();
+	}
 
 	send_msg("PASS :" + pass_ + "\r\n");
 	send_msg("NICK :" + nick_ + "\r\n");
@@ -122,9 +138,9 @@ void client::cleanup()
 	ev_sock_writable_.stop();
 	ev_sock_timeout_.stop();
 	ev_msg_out_.stop();
-	outBuffer_ = std::stringstream();
-	inBuffer_ = std::stringstream();
-	while (queue_msg_in.pop()) {}
+	ev_resume_.stop();
+	out_.clear();
+	in_.clear();
 	if (state != ERRORED) state = CLOSED;
 }
 
@@ -132,49 +148,58 @@ void client::queue_msg(const irc_msg& msg)
 {
 	if (msg.command == IRCMESSAGE_INVALID) return;
 
-	queue_msg_out_.push(msg);
-	ev_msg_out_.send();
+	// On a shared loop the caller is already on our thread.
+	if (!own_loop_) {
+		if (socketFd_ != -1) send(msg);
+		return;
+	}
+
+	if (!queue_msg_out_.push(irc_msg(msg)))
+		std::cerr << "IRCClient " << host_ << ":" << port_ << " send queue full, dropping: " << msg;
 }
 
-int client::send_msg(const std::string& raw)
+int client::send_msg(std::string_view raw)
 {
-	auto count = write(socketFd_, raw.c_str(), raw.size());
-	if (count == -1) {
-		auto errn = errno;
-		if (errn == EAGAIN || errn == EWOULDBLOCK) {
-			outBuffer_ << raw;
-			ev_sock_writable_.start();
-			return 0;
-		}
-		else {
-			std::cerr << "IRCClient " << host_ << ":" << port_ << " write error: ";
-			std::cerr << strerror(errn) << std::endl;
-			state = ERRORED;
-			cleanup();
-			return errn;
+	// Once anything is queued, the rest has to go behind it.
+	if (out_.empty()) {
+		auto count = write(socketFd_, raw.data(), raw.size());
+		if (count == -1) {
+			auto errn = errno;
+			if (errn != EAGAIN && errn != EWOULDBLOCK) {
+				std::cerr << "IRCClient " << host_ << ":" << port_ << " write error: ";
+				std::cerr << strerror(errn) << std::endl;
+				state = ERRORED;
+				cleanup();
+				return errn;
+			}
+			count = 0;
 		}
+		raw.remove_prefix(count);
+		if (raw.empty()) return 0;
 	}
-	else if ((size_t)count < raw.size()) {
-		// Leftovers will be queued for writing.
-		size_t leftover = raw.size() - count;
-		outBuffer_.write(raw.c_str() + count, leftover);
-		ev_sock_writable_.start();
+
+	// Leftovers will be queued for writing.
+	if (!out_.write(raw.data(), raw.size())) {
+		std::cerr << "IRCClient " << host_ << ":" << port_ << " output buffer full" << std::endl;
+		state = ERRORED;
+		cleanup();
+		return ENOBUFS;
 	}
+	ev_sock_writable_.start();
 	return 0;
 }
 
 void client::writable(ev::io&, int)
 {
-	// Check outBuffer and resend bytes as needed.
-	auto toWrite = outBuffer_.rdbuf()->in_avail();
-	if (toWrite <= 0) {
+	iovec iov[2];
+	int n = out_.data(iov);
+	if (n == 0) {
 		// well, what are we doing here???
-		outBuffer_ = std::stringstream();
 		ev_sock_writable_.stop();
 		return;
 	}
 
-	auto count = write(socketFd_, outBuffer_.view().data(), toWrite);
+	auto count = writev(socketFd_, iov, n);
 	if (count == -1) {
 		auto errn = errno;
 		if (errn == EAGAIN || errn == EWOULDBLOCK) {
@@ -189,13 +214,9 @@ void client::writable(ev::io&, int)
 			return;
 		}
 	}
-	else if (count < toWrite) {
-		size_t leftover = toWrite - count;
-		outBuffer_.seekg(leftover, std::ios_base::cur);
-	}
-	else {
-		outBuffer_ = std::stringstream();
-	}
+
+	out_.consume(count);
+	if (out_.empty()) ev_sock_writable_.stop();
 }
 
 void client::timeout(ev::timer&, int)
@@ -214,13 +235,14 @@ void client::timeout(ev::timer&, int)
 
 void client::readable(ev::io&, int)
 {
-	char buf[IRCMSG_BUF];
+	ssize_t count;
 
-	auto count = read(socketFd_, buf, IRCMSG_BUF);
-	while (count > 0 && count <= IRCMSG_BUF) {
-		inBuffer_.write(buf, count);
-		count = read(socketFd_, buf, IRCMSG_BUF);
-	}
+	do {
+		iovec iov[2];
+		count = readv(socketFd_, iov, in_.free(iov));
+		if (count > 0) in_.produce(count);
+		if (!parse_lines()) return;
+	} while (count > 0);
 
 	if (count == -1) {
 		auto errn = errno;
@@ -240,71 +262,116 @@ void client::readable(ev::io&, int)
 	}
 
 	ev_sock_timeout_.again();
+}
 
-	auto view = inBuffer_.view();
-
-	std::string::size_type from = 0;
-	std::string::size_type to = view.find('\n');
-	while (to != std::string::npos) {
-		auto msg = std::string(view.substr(from, to - from + 1));
-		if (msg_in(msg)) {
-			std::cout << "ircclient invalid: " << msg;
+// Hands every complete line in in_ on. Returns false if the socket
+// was closed or the app's queue filled up; the line that didn't fit
+// stays in in_ for resumed().
+bool client::parse_lines()
+{
+	char scratch[IRCMSG_BUF];
+	irc_msg_view msg;
+
+	// Lines are parsed where they lie in the ring, and only what
+	// goes to the app is copied.
+	size_t len;
+	while ((len = in_.line()) != 0) {
+		if (len > IRCMSG_BUF) {
+			std::cout << "ircclient invalid: " << len << " byte line" << std::endl;
+		}
+		else {
+			auto line = in_.view(len, scratch);
+			if (!msg.parse(line) || msg_in(line, msg)) {
+				std::cout << "ircclient invalid: " << line;
+			}
+			if (socketFd_ == -1 || paused_) return false;
 		}
-		from = to + 1;
-		to = view.find('\n', from);
+		in_.consume(len);
 	}
 
-	if (view.substr(from).empty()) {
-		inBuffer_ = std::stringstream();
-	}
-	else {
-		inBuffer_ = std::stringstream(std::string(view.substr(from)), std::ios_base::in | std::ios_base::out | std::ios_base::ate);
+	// A full ring without a line end in it will never have one.
+	if (in_.space() == 0) {
+		std::cout << "ircclient invalid: line longer than " << in_.capacity << " bytes" << std::endl;
+		in_.clear();
 	}
+	return true;
+}
 
-	if (queue_msg_in.size() != 0)
-		ev_msg_in_callback_->send();
+void client::resume()
+{
+	ev_resume_.send();
+}
+
+void client::resumed(ev::async&, int)
+{
+	if (!paused_ || socketFd_ == -1) return;
+	paused_ = false;
+	if (!parse_lines()) return;
+	ev_sock_readable_.start();
+	ev_sock_timeout_.again();
 }
 
 void client::msg_out(ev::async&, int)
 {
-	while (auto msg = queue_msg_out_.pop()) {
-		if ((*msg).command == IRCMESSAGE_INVALID) continue;
-		std::cout << "Send message: " << *msg;
-		if (msg->command == "QUIT") {
-			cleanup();
-			state = client_state::CLOSED;
-		}
-		else {
-			send_msg(msg->compose());
-		}
-	}
+	queue_msg_out_.drain([this](const irc_msg& msg) {
+		if (socketFd_ != -1) send(msg);
+	});
 }
 
-int client::msg_in(const irc_msg& msg)
+void client::send(const irc_msg& msg)
 {
-	// XXX: this is debug
-	if (msg.command == IRCMESSAGE_INVALID) {
-		return 1;
+	char buf[IRCMSG_BUF];
+	std::cout << "Send message: " << msg;
+	if (msg.command == "QUIT") {
+		cleanup();
+		state = client_state::CLOSED;
+	}
+	else if (auto len = msg.compose(buf, sizeof(buf))) {
+		send_msg({buf, len});
+	}
+	else {
+		std::cerr << "IRCClient: message too long: " << msg;
 	}
+}
 
+int client::msg_in(std::string_view line, const irc_msg_view& msg)
+{
 	// TODO: code parsing not implemented yet
 	if (msg.code) {
-		switch (*msg.code) {
+		switch (msg.code) {
 			// Certain messages we can discard for now.
 		}
-		queue_msg_in.push(msg);
+		deliver(line, msg);
 	}
 	else {
 		if (msg.command == "PING") {
-			if (msg.params && msg.params->trailer) {
-				queue_msg_out_.push({"PONG", {*msg.params->trailer}, {}});
-				ev_msg_out_.send();
+			// Answered right here, without a trip through the queue.
+			char buf[IRCMSG_BUF];
+			if (msg.has_trailer && msg.trailer.size() + 8 <= sizeof(buf)) {
+				std::memcpy(buf, "PONG :", 6);
+				std::memcpy(buf + 6, msg.trailer.data(), msg.trailer.size());
+				std::memcpy(buf + 6 + msg.trailer.size(), "\r\n", 2);
+				send_msg({buf, msg.trailer.size() + 8});
 			}
 		}
 		else
-			queue_msg_in.push(msg);
+			deliver(line, msg);
 	}
 	return 0;
 }
 
+void client::deliver(std::string_view line, const irc_msg_view& msg)
+{
+	if (on_msg_) {
+		on_msg_(msg);
+	}
+	else if (!queue_msg_in.push(std::string(line))) {
+		// Stop reading until the app has caught up, so the server
+		// backs off instead of us losing lines.
+		paused_ = true;
+		ev_sock_readable_.stop();
+		ev_sock_timeout_.stop();
+	}
+}
+
 }// namespace ircddb
@@ -21,13 +21,14 @@
 
 #ifndef IRCDDB_CLIENT_H
 #define IRCDDB_CLIENT_H
-#include "common/threaded_queue.h"
+#include "common/byte_ring.h"
+#include "common/ring_queue.h"
 #include "ircddb/irc_msg.h"
 #include <atomic>
 #include <cstdint>
 #include <ev++.h>
+#include <functional>
 #include <memory>
-#include <sstream>
 #include <string>
 
 namespace ircddb {
@@ -43,7 +44,14 @@ enum client_state {
 
 class client {
 public:
+	using handler = std::function<void(const irc_msg_view&)>;
+
+	// Threaded: the client runs its own loop in run(). Incoming lines
+	// are queued on queue_msg_in and ev_msg_in_callback is signalled.
 	client(const std::string& host, const uint_least16_t port, const std::string& pass, const std::string& nick, const std::string& user, const std::string& realname, std::shared_ptr<ev::async> ev_msg_in_callback);
+	// Shared loop: the client runs on loop, and every message goes
+	// straight from the parser to on_msg.
+	client(ev::loop_ref loop, const std::string& host, const uint_least16_t port, const std::string& pass, const std::string& nick, const std::string& user, const std::string& realname, handler on_msg);
 
 	// Resolves the host and opens a connection socket, but doesn't
 	// connect.
@@ -62,34 +70,46 @@ public:
 	void queue_msg(const irc_msg& msg);
 
 	std::atomic<client_state> state;
-	threaded_queue<irc_msg> queue_msg_in;
+	// Raw lines, for the threaded client only. Signals
+	// ev_msg_in_callback when the app has drained it and more arrive.
+	// When it is full the client stops reading until resume().
+	signalled_queue<spsc_queue<std::string, 4096>> queue_msg_in;
+	// Called by the app after draining queue_msg_in, from any thread.
+	void resume();
 
 	void run();
 
 	~client();
 
 private:
-	int send_msg(const std::string& msg);
+	int send_msg(std::string_view msg);
 
 	void readable(ev::io& io, int revents);
 	void writable(ev::io& io, int revents);
 	void timeout(ev::timer& timer, int revents);
 
 	void msg_out(ev::async&, int revents);
-	int msg_in(const irc_msg& msg);
+	void resumed(ev::async&, int revents);
+	bool parse_lines();
+	void send(const irc_msg& msg);
+	int msg_in(std::string_view line, const irc_msg_view& msg);
+	void deliver(std::string_view line, const irc_msg_view& msg);
 
 	void cleanup();
 
-	threaded_queue<irc_msg> queue_msg_out_;
+	signalled_queue<spsc_queue<irc_msg, 256>> queue_msg_out_;
 
-	ev::dynamic_loop loop_;
+	std::unique_ptr<ev::dynamic_loop> own_loop_;
+	ev::loop_ref loop_;
 
 	ev::io ev_sock_readable_;
 	ev::io ev_sock_writable_;
 	ev::timer ev_sock_timeout_;
 
 	ev::async ev_msg_out_;
+	ev::async ev_resume_;
 	std::shared_ptr<ev::async> ev_msg_in_callback_;
+	handler on_msg_;
 
 	std::string host_;
 	uint_least16_t port_;
@@ -98,9 +118,10 @@ private:
 	std::string user_;
 	std::string realname_;
 	int socketFd_;
+	bool paused_ = false;
 
-	std::stringstream outBuffer_;
-	std::stringstream inBuffer_;
+	byte_ring<16384> out_;
+	byte_ring<8192> in_;
 };
 
 }// namespace ircddb
@@ -0,0 +1,213 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "gate_writer.h"
+#include <algorithm>
+#include <iostream>
+
+namespace ircddb {
+
+gate_writer::gate_writer(std::shared_ptr<lmdb::env> env, std::size_t max_batch, std::chrono::milliseconds max_delay)
+	: env_(env), max_batch_(max_batch), max_delay_(max_delay)
+{
+	pending_.reserve(max_batch_);
+	thread_ = std::thread(&gate_writer::run, this);
+}
+
+gate_writer::~gate_writer()
+{
+	stop();
+}
+
+void gate_writer::put(std::shared_ptr<lmdb::dbi> db, std::string key, std::string value, std::uint64_t mark)
+{
+	push({op_kind::put, std::move(db), std::move(key), std::move(value), 0, mark});
+}
+
+void gate_writer::del(std::shared_ptr<lmdb::dbi> db, std::string key, std::uint64_t mark)
+{
+	push({op_kind::del, std::move(db), std::move(key), {}, 0, mark});
+}
+
+void gate_writer::replace_dup(std::shared_ptr<lmdb::dbi> db, std::string key, std::string value, std::size_t prefix, std::uint64_t mark)
+{
+	push({op_kind::replace_dup, std::move(db), std::move(key), std::move(value), prefix, mark});
+}
+
+void gate_writer::push(op&& o)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (stopping_) return;
+	pending_.push_back(std::move(o));
+	queued_++;
+	// Wake the writer to start the delay clock, or to commit a full batch.
+	if (pending_.size() == 1 || pending_.size() >= max_batch_) wake_.notify_one();
+}
+
+void gate_writer::on_commit(hook f)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	on_commit_ = std::move(f);
+}
+
+void gate_writer::on_drop(hook f)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	on_drop_ = std::move(f);
+}
+
+bool gate_writer::flush()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto target = queued_;
+	auto dropped = dropped_;
+	if (written_ + dropped_ < target && running_) {
+		flushing_ = true;
+		wake_.notify_one();
+		done_.wait(lock, [&] { return written_ + dropped_ >= target || !running_; });
+	}
+	return dropped_ == dropped && written_ + dropped_ >= target;
+}
+
+void gate_writer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (stopping_) return;
+		stopping_ = true;
+	}
+	wake_.notify_one();
+	thread_.join();
+}
+
+std::uint64_t gate_writer::records() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return written_;
+}
+
+std::uint64_t gate_writer::commits() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return commits_;
+}
+
+std::uint64_t gate_writer::dropped() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return dropped_;
+}
+
+void gate_writer::run()
+{
+	std::vector<op> batch;
+	batch.reserve(max_batch_);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+		wake_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+		wake_.wait_for(lock, max_delay_, [&] { return stopping_ || flushing_ || pending_.size() >= max_batch_; });
+
+		if (pending_.empty() && stopping_) {
+			running_ = false;
+			break;
+		}
+
+		batch.swap(pending_);
+		flushing_ = false;
+		auto done = on_commit_;
+		lock.unlock();
+
+		std::uint64_t mark = 0;
+		for (const auto& o : batch)
+			mark = std::max(mark, o.mark);
+
+		bool ok = commit(batch);
+		if (ok && done) done(mark);
+		// Give the disk a moment before trying again.
+		if (!ok && failures_ + 1 < max_attempts) std::this_thread::sleep_for(max_delay_);
+
+		lock.lock();
+		if (ok) {
+			written_ += batch.size();
+			commits_++;
+			failures_ = 0;
+		}
+		else if (++failures_ < max_attempts) {
+			// Retried ahead of anything queued meanwhile.
+			batch.insert(batch.end(), std::make_move_iterator(pending_.begin()), std::make_move_iterator(pending_.end()));
+			pending_.swap(batch);
+		}
+		else {
+			std::cerr << "ircddb: gate_writer: dropping " << batch.size() << " records" << std::endl;
+			dropped_ += batch.size();
+			failures_ = 0;
+			auto drop = on_drop_;
+			lock.unlock();
+			if (drop) drop(mark);
+			lock.lock();
+		}
+		batch.clear();
+		done_.notify_all();
+	}
+	done_.notify_all();
+}
+
+bool gate_writer::commit(std::vector<op>& batch)
+{
+	try {
+		auto wtxn = lmdb::txn::begin(*env_);
+		for (const auto& o : batch) {
+			switch (o.kind) {
+			case op_kind::put:
+				o.db->put(wtxn, o.key, o.value);
+				break;
+			case op_kind::del:
+				o.db->del(wtxn, o.key);
+				break;
+			case op_kind::replace_dup: {
+				// Seek to the first duplicate at or after the prefix
+				// followed by zeroes.
+				std::string first(o.value.size(), '\0');
+				first.replace(0, o.prefix, o.value, 0, o.prefix);
+
+				auto cur = lmdb::cursor::open(wtxn, *o.db);
+				std::string_view k = o.key, v = first;
+				if (cur.get(k, v, MDB_GET_BOTH_RANGE) && v.substr(0, o.prefix) == first.substr(0, o.prefix))
+					cur.del();
+				cur.close();
+
+				o.db->put(wtxn, o.key, o.value);
+				break;
+			}
+			}
+		}
+		wtxn.commit();
+		return true;
+	}
+	catch (const lmdb::error& e) {
+		std::cerr << "ircddb: gate_writer: commit of " << batch.size() << " records failed: " << e.what() << std::endl;
+		return false;
+	}
+}
+
+}// namespace ircddb
@@ -0,0 +1,123 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef IRCDDB_GATE_WRITER_H
+#define IRCDDB_GATE_WRITER_H
+
+#include "common/lmdb++.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ircddb {
+
+// Write-behind batcher for gate updates. Writes are queued by the IRC
+// handlers and applied on a writer thread in a single transaction,
+// committed every max_batch records or every max_delay, whichever comes
+// first. The caller never waits on disk except in flush().
+class gate_writer {
+public:
+	gate_writer(std::shared_ptr<lmdb::env> env, std::size_t max_batch = 512, std::chrono::milliseconds max_delay = std::chrono::milliseconds(250));
+	gate_writer(const gate_writer&) = delete;
+	gate_writer& operator=(const gate_writer&) = delete;
+	~gate_writer();
+
+	// A write may carry a mark of the caller's, such as a
+	// route_cache::mark(). The hooks are handed the highest mark in the
+	// batch they follow, or 0 if it had none.
+	using hook = std::function<void(std::uint64_t mark)>;
+
+	void put(std::shared_ptr<lmdb::dbi> db, std::string key, std::string value, std::uint64_t mark = 0);
+	void del(std::shared_ptr<lmdb::dbi> db, std::string key, std::uint64_t mark = 0);
+	// For MDB_DUPSORT tables: replaces the duplicate of key whose first
+	// prefix bytes match value, or adds value if there is none.
+	void replace_dup(std::shared_ptr<lmdb::dbi> db, std::string key, std::string value, std::size_t prefix, std::uint64_t mark = 0);
+
+	// Called on the writer thread after every successful commit.
+	void on_commit(hook f);
+	// Called on the writer thread when a batch is given up on after
+	// max_attempts failed commits.
+	void on_drop(hook f);
+
+	// Block until everything queued so far is committed or dropped.
+	// Returns false if anything was dropped meanwhile.
+	bool flush();
+	// Flush and stop the writer thread. Further writes are dropped.
+	void stop();
+
+	std::uint64_t records() const;
+	std::uint64_t commits() const;
+	std::uint64_t dropped() const;
+
+	static constexpr int max_attempts = 3;
+
+private:
+	enum class op_kind {
+		put,
+		del,
+		replace_dup,
+	};
+
+	struct op {
+		op_kind kind;
+		std::shared_ptr<lmdb::dbi> db;
+		std::string key;
+		std::string value;
+		std::size_t prefix = 0;
+		std::uint64_t mark = 0;
+	};
+
+	void push(op&& o);
+	void run();
+	bool commit(std::vector<op>& batch);
+
+	std::shared_ptr<lmdb::env> env_;
+	std::size_t max_batch_;
+	std::chrono::milliseconds max_delay_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::vector<op> pending_;
+	std::uint64_t queued_ = 0;
+	std::uint64_t written_ = 0;
+	std::uint64_t commits_ = 0;
+	std::uint64_t dropped_ = 0;
+	int failures_ = 0;
+	bool stopping_ = false;
+	bool flushing_ = false;
+	bool running_ = true;
+	hook on_commit_;
+	hook on_drop_;
+
+	std::thread thread_;
+};
+
+}// namespace ircddb
+
+#endif
@@ -20,8 +20,9 @@
 //
 
 #include "irc_msg.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <regex>
 #include <sstream>
 
 namespace ircddb {
@@ -59,67 +60,148 @@ std::string irc_msg::compose() const
 	return s.str();
 }
 
-static const std::regex IRC_MSG_REGEX("^(?:\\:([A-Za-z0-9\\-.]+|[A-Za-z0-9\\-\\x5B-\\x60\\x7B-\\x7D]+(?:(?:![^\\0\\r\\n @]+)?@[A-Za-z0-9\\-.:]+)?) )?([A-Za-z]+|[0-9]{3})((?: [^\\0\\r\\n :][^\\0\\r\\n ]*){0,14})( :?[^\\0\\r\\n]*?)?\\r?\\n?$", std::regex_constants::ECMAScript | std::regex_constants::optimize);
-
-static const std::regex IRC_PFX_REGEX("^(?:([A-Za-z\\x5B-\\x60\\x7B-\\x7D][A-Za-z0-9\\-\\x5B-\\x60\\x7B-\\x7D]*)(?:(![^\\0\\r\\n @]+)?@([A-Za-z0-9\\-.:]+))?|([A-Za-z0-9\\-.:]+))$", std::regex_constants::ECMAScript | std::regex_constants::optimize);
-
-irc_msg::irc_msg(const std::string& raw)
+size_t irc_msg::compose(char* buf, size_t len) const
 {
-	std::smatch base_match;
-	if (!std::regex_match(raw, base_match, IRC_MSG_REGEX, std::regex_constants::match_not_null)) {
-		command = IRCMESSAGE_INVALID;
-		return;
-	}
-	if (base_match[1].matched) {
-		prefix = base_match[1];
-		std::smatch pfx_match;
-		if (std::regex_match(*prefix, pfx_match, IRC_PFX_REGEX, std::regex_constants::match_not_null)) {
-			irc_prefix p;
-			if (pfx_match[4].matched) {
-				p.host = pfx_match[4];
-			}
-			if (pfx_match[3].matched) {
-				p.host = pfx_match[3];
-			}
-			if (pfx_match[2].matched) {
-				p.user = pfx_match[2].str().substr(1);
-			}
-			if (pfx_match[1].matched) {
-				p.nick = pfx_match[1];
-			}
-			pfx = p;
+	size_t n = 0;
+	bool fits = true;
+	auto put = [&](std::string_view s) {
+		if (!fits || n + s.size() > len) {
+			fits = false;
+			return;
 		}
+		std::memcpy(buf + n, s.data(), s.size());
+		n += s.size();
+	};
+
+	if (prefix) {
+		put(":");
+		put(*prefix);
+		put(" ");
 	}
-	// Really, this should never happen.
-	if (!base_match[2].matched) {
-		command = IRCMESSAGE_INVALID;
-		return;
+	put(command);
+	if (params) {
+		for (const auto& param : params->list) {
+			put(" ");
+			put(param);
+		}
+		if (params->trailer) {
+			put(" :");
+			put(*params->trailer);
+		}
 	}
-	command = base_match[2];
-	if (command.size() == 3) {
-		try {
-			int code_ = std::stoi(command);
-			code = code_;
+	put("\r\n");
+
+	return fits ? n : 0;
+}
+
+static bool is_alpha(char c)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+bool irc_msg_view::parse(std::string_view s)
+{
+	prefix = nick = user = host = command = trailer = {};
+	code = 0;
+	param_count = 0;
+	has_trailer = false;
+
+	if (s.ends_with('\n')) s.remove_suffix(1);
+	if (s.ends_with('\r')) s.remove_suffix(1);
+	if (s.find_first_of(std::string_view("\0\r\n", 3)) != std::string_view::npos) return false;
+
+	size_t pos = 0;
+
+	// :nick!user@host or :server.name
+	if (s.starts_with(':')) {
+		pos = s.find(' ');
+		if (pos == std::string_view::npos || pos == 1) return false;
+		prefix = s.substr(1, pos - 1);
+
+		auto bang = prefix.find('!');
+		auto at = prefix.find('@');
+		if (bang == std::string_view::npos && at == std::string_view::npos) {
+			if (prefix.find('.') != std::string_view::npos)
+				host = prefix;
+			else
+				nick = prefix;
 		}
-		catch (...) {
+		else {
+			nick = prefix.substr(0, std::min(bang, at));
+			if (bang < at) user = prefix.substr(bang + 1, at == std::string_view::npos ? at : at - bang - 1);
+			if (at != std::string_view::npos) host = prefix.substr(at + 1);
 		}
-	};
+		pos++;
+	}
 
-	auto p = irc_params();
-	if (base_match[3].matched) {
-		std::istringstream buf(base_match[3]);
-		std::string arg;
-		while (buf >> arg) {
-			p.list.push_back(arg);
+	// Letters, or a three digit reply code.
+	auto end = std::min(s.find(' ', pos), s.size());
+	command = s.substr(pos, end - pos);
+	if (command.empty()) return false;
+	if (is_digit(command[0])) {
+		if (command.size() != 3 || !is_digit(command[1]) || !is_digit(command[2])) return false;
+		code = (command[0] - '0') * 100 + (command[1] - '0') * 10 + (command[2] - '0');
+	}
+	else {
+		for (char c : command)
+			if (!is_alpha(c)) return false;
+	}
+	pos = end;
+
+	// Up to 14 middle params, then the trailer, which may have spaces.
+	while (pos < s.size()) {
+		while (pos < s.size() && s[pos] == ' ') pos++;
+		if (pos == s.size()) break;
+
+		if (s[pos] == ':' || param_count == max_params) {
+			trailer = s.substr(s[pos] == ':' ? pos + 1 : pos);
+			has_trailer = true;
+			break;
 		}
+
+		end = std::min(s.find(' ', pos), s.size());
+		params[param_count++] = s.substr(pos, end - pos);
+		pos = end;
+	}
+
+	return true;
+}
+
+irc_msg::irc_msg(const std::string& raw)
+{
+	irc_msg_view v;
+	if (v.parse(raw))
+		*this = irc_msg(v);
+	else
+		command = IRCMESSAGE_INVALID;
+}
+
+irc_msg::irc_msg(const irc_msg_view& v) : command(v.command)
+{
+	if (!v.prefix.empty()) {
+		prefix = std::string(v.prefix);
+		irc_prefix p;
+		if (!v.nick.empty()) p.nick = std::string(v.nick);
+		if (!v.user.empty()) p.user = std::string(v.user);
+		if (!v.host.empty()) p.host = std::string(v.host);
+		pfx = p;
 	}
-	if (base_match[4].matched) {
-		auto trailer = base_match[4].str();
-		if (trailer.starts_with(' ')) trailer = trailer.substr(1);
-		if (trailer.starts_with(':')) trailer = trailer.substr(1);
-		p.trailer = trailer;
+
+	if (v.code) code = v.code;
+
+	if (v.param_count || v.has_trailer) {
+		irc_params p;
+		p.list.reserve(v.param_count);
+		for (int i = 0; i < v.param_count; i++)
+			p.list.emplace_back(v.params[i]);
+		if (v.has_trailer) p.trailer = std::string(v.trailer);
+		params = std::move(p);
 	}
-	if (base_match[3].matched || base_match[4].matched) params = p;
 }
 
 irc_msg::irc_msg(const std::string& to, const std::string& msg)
@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #define IRCMESSAGE_INVALID "IRCMESSAGE_INVALID"
@@ -217,9 +218,34 @@ struct irc_prefix {
 	std::optional<std::string> nick;
 };
 
+// A message parsed in place. Every field points into the line it came
+// from, so it's only good for as long as that buffer is; convert it to
+// an irc_msg to keep it or hand it to another thread.
+struct irc_msg_view {
+	static constexpr int max_params = 14;
+
+	// Single pass, no allocation. Returns false if the line isn't a
+	// message.
+	bool parse(std::string_view line);
+
+	std::string_view prefix;
+	std::string_view nick;
+	std::string_view user;
+	std::string_view host;
+
+	std::string_view command;
+	uint_least16_t code;// 0 if the command isn't numeric
+
+	std::string_view params[max_params];
+	int param_count;
+	std::string_view trailer;
+	bool has_trailer;
+};
+
 struct irc_msg {
 	irc_msg() = default;
 	irc_msg(const std::string& raw);
+	irc_msg(const irc_msg_view& v);
 	irc_msg(const std::string& to, const std::string& msg);
 	irc_msg(const std::string& command, const std::vector<std::string>& params, const std::optional<std::string>& trailer = {});
 
@@ -233,6 +259,9 @@ struct irc_msg {
 
 	friend std::ostream& operator<<(std::ostream& os, const irc_msg& msg);
 	std::string compose() const;
+	// Writes the message with its CRLF to buf without allocating.
+	// Returns the length, or 0 if it doesn't fit.
+	size_t compose(char* buf, size_t len) const;
 };
 
 }// namespace ircddb
@@ -0,0 +1,138 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef IRCDDB_RECORDS_H
+#define IRCDDB_RECORDS_H
+
+#include "dv/callsign.h"
+#include <arpa/inet.h>
+#include <cstdint>
+#include <ctime>
+#include <string_view>
+#include <sys/socket.h>
+
+namespace ircddb {
+
+// Record layouts of the ircDDB LMDB tables. Everything is made of bytes so
+// a record can be read in place from the memory map with
+// lmdb::view_from_sv.
+//
+// zone_ip4, zone_ip6: key is the zone callsign field, values are one
+// gate_addr per IRC server (MDB_DUPSORT | MDB_DUPFIXED). Duplicates sort
+// by server id first.
+// zone_nick: key is a nick_key, value is the gate's nick.
+// irc_sync: key is "host:port" of an IRC server, value is a sync_record.
+// The same table holds the encoded route_policy under route_policy_key,
+// so dgate ranks routes the way ircddb does.
+
+inline std::time_t load_time(const uint8_t* b)
+{
+	uint64_t t = 0;
+	for (int i = 0; i < 8; i++)
+		t = t << 8 | b[i];
+	return static_cast<std::time_t>(t);
+}
+
+inline void store_time(uint8_t* b, std::time_t t)
+{
+	auto v = static_cast<uint64_t>(t);
+	for (int i = 7; i >= 0; i--) {
+		b[i] = v & 0xFF;
+		v >>= 8;
+	}
+}
+
+struct zone_key {
+	char zone[dv::callsign::size];
+
+	static zone_key make(dv::callsign zone)
+	{
+		zone_key k;
+		zone.to_field(k.zone);
+		return k;
+	}
+
+	dv::callsign callsign() const { return dv::callsign::from_field(zone); }
+};
+
+struct nick_key {
+	char zone[dv::callsign::size];
+	uint8_t server;
+
+	static nick_key make(dv::callsign zone, int server)
+	{
+		nick_key k;
+		zone.to_field(k.zone);
+		k.server = server;
+		return k;
+	}
+};
+
+struct gate_addr {
+	uint8_t server;
+	uint8_t updated[8];// big endian unix time
+	uint8_t addr[16];  // IPv4 uses the first 4 bytes
+
+	// Parses a textual host address. Returns false if it is not an
+	// address of the given family.
+	bool set(int server_id, std::time_t now, int af, std::string_view host)
+	{
+		*this = {};
+		server = server_id;
+		set_updated(now);
+
+		char s[INET6_ADDRSTRLEN];
+		if (host.size() >= sizeof(s)) return false;
+		host.copy(s, host.size());
+		s[host.size()] = '\0';
+		return inet_pton(af, s, addr) == 1;
+	}
+
+	std::time_t time() const { return load_time(updated); }
+	void set_updated(std::time_t t) { store_time(updated, t); }
+};
+
+// How fresh our copy of one IRC server's channel is.
+struct sync_record {
+	uint8_t updated[8];  // last gate record from this server
+	uint8_t full_sync[8];// last completed WHO
+
+	std::time_t last_update() const { return load_time(updated); }
+	std::time_t last_full_sync() const { return load_time(full_sync); }
+};
+
+// A snapshot is refreshed with a full WHO once its last update is this
+// old, or its last WHO is so old that the JOINs and QUITs missed across
+// restarts may have piled up.
+inline constexpr std::string_view route_policy_key = "route_policy";
+
+inline constexpr std::time_t max_snapshot_age = 15 * 60;
+inline constexpr std::time_t max_full_sync_age = 4 * 60 * 60;
+
+inline bool snapshot_fresh(std::time_t last_update, std::time_t last_full_sync, std::time_t now)
+{
+	return last_full_sync != 0 && now - last_full_sync < max_full_sync_age && now - last_update < max_snapshot_age;
+}
+
+}// namespace ircddb
+
+#endif
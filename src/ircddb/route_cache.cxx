@@ -0,0 +1,306 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#include "route_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <thread>
+
+namespace ircddb {
+
+route_result route_cache::lookup(dv::callsign zone, std::time_t now) const
+{
+	route_result res;
+
+	int v = version_.load(std::memory_order_acquire);
+	readers_[v].fetch_add(1, std::memory_order_seq_cst);
+
+	const auto& idx = index_[current_.load(std::memory_order_seq_cst)];
+	auto it = idx.find(zone);
+	if (it != idx.end()) {
+		const auto& e = it->second;
+		if (e.count > 0) {
+			res.status = route_status::hit;
+			res.count = e.count;
+			res.routes[0] = e.routes[e.best];
+			for (std::size_t i = 0, n = 1; i < e.count; i++)
+				if (i != e.best) res.routes[n++] = e.routes[i];
+		}
+		else if (now < e.negative_until) {
+			res.status = route_status::negative;
+		}
+	}
+
+	readers_[v].fetch_sub(1, std::memory_order_release);
+	return res;
+}
+
+std::optional<route> route_cache::best(dv::callsign zone) const
+{
+	std::optional<route> r;
+
+	int v = version_.load(std::memory_order_acquire);
+	readers_[v].fetch_add(1, std::memory_order_seq_cst);
+
+	const auto& idx = index_[current_.load(std::memory_order_seq_cst)];
+	auto it = idx.find(zone);
+	if (it != idx.end() && it->second.count > 0) r = it->second.routes[it->second.best];
+
+	readers_[v].fetch_sub(1, std::memory_order_release);
+	return r;
+}
+
+void route_cache::set_policy(const route_policy& policy)
+{
+	write([&](index& idx) {
+		policy_ = policy;
+		for (auto& [zone, e] : idx)
+			e.choose(policy_);
+	});
+}
+
+void route_cache::set(dv::callsign zone, int af, const gate_addr& a)
+{
+	change c{zone, false, 0, {a.server, static_cast<uint8_t>(af), a.time(), {}}};
+	std::memcpy(c.r.addr.data(), a.addr, sizeof(a.addr));
+
+	std::lock_guard<std::mutex> lock(pending_mutex_);
+	pending_.push_back(c);
+}
+
+void route_cache::note_miss(dv::callsign zone, std::time_t now)
+{
+	std::lock_guard<std::mutex> lock(pending_mutex_);
+	pending_.push_back({zone, true, now + negative_ttl, {}});
+}
+
+uint64_t route_cache::mark() const
+{
+	std::lock_guard<std::mutex> lock(pending_mutex_);
+	return taken_ + pending_.size();
+}
+
+// Removes the changes queued before upto from pending_.
+std::vector<route_cache::change> route_cache::take(uint64_t upto)
+{
+	std::lock_guard<std::mutex> lock(pending_mutex_);
+	auto n = static_cast<std::size_t>(std::min<uint64_t>(pending_.size(), upto > taken_ ? upto - taken_ : 0));
+	std::vector<change> changes(pending_.begin(), pending_.begin() + n);
+	pending_.erase(pending_.begin(), pending_.begin() + n);
+	taken_ += n;
+	return changes;
+}
+
+void route_cache::publish(uint64_t upto)
+{
+	auto changes = take(upto);
+	if (changes.empty()) return;
+
+	// Misses carry the time they were noted; whatever had expired by the
+	// latest of them is dropped.
+	std::time_t now = 0;
+	std::vector<dv::callsign> expired;
+	{
+		std::lock_guard<std::mutex> lock(pending_mutex_);
+		for (const auto& c : changes) {
+			if (!c.miss) continue;
+			now = std::max(now, c.until - negative_ttl);
+			negatives_.emplace_back(c.until, c.zone);
+		}
+		while (!negatives_.empty() && negatives_.front().first <= now) {
+			expired.push_back(negatives_.front().second);
+			negatives_.pop_front();
+		}
+	}
+
+	write([&](index& idx) { apply(idx, changes, expired, now); });
+}
+
+void route_cache::discard(uint64_t upto)
+{
+	take(upto);
+}
+
+void route_cache::clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(pending_mutex_);
+		taken_ += pending_.size();
+		pending_.clear();
+		negatives_.clear();
+	}
+	write([](index& idx) { idx.clear(); });
+}
+
+void route_cache::rebuild(lmdb::env& env, lmdb::dbi& zone_ip4, lmdb::dbi& zone_ip6)
+{
+	index fresh;
+
+	auto rtxn = lmdb::txn::begin(env, nullptr, MDB_RDONLY);
+	for (auto [db, af] : {std::pair{&zone_ip4, AF_INET}, std::pair{&zone_ip6, AF_INET6}}) {
+		auto cur = lmdb::cursor::open(rtxn, *db);
+		std::string_view k;
+		while (auto a = cur.get_as<gate_addr>(k, MDB_NEXT)) {
+			if (k.size() != sizeof(zone_key)) continue;
+			route r{a->server, static_cast<uint8_t>(af), a->time(), {}};
+			std::memcpy(r.addr.data(), a->addr, sizeof(a->addr));
+			fresh[lmdb::view_from_sv<zone_key>(k)->callsign()].set(r);
+		}
+	}
+	rtxn.abort();
+
+	write([&](index& idx) {
+		idx = fresh;
+		for (auto& [zone, e] : idx)
+			e.choose(policy_);
+	});
+}
+
+std::size_t route_cache::size() const
+{
+	int v = version_.load(std::memory_order_acquire);
+	readers_[v].fetch_add(1, std::memory_order_seq_cst);
+	auto n = index_[current_.load(std::memory_order_seq_cst)].size();
+	readers_[v].fetch_sub(1, std::memory_order_release);
+	return n;
+}
+
+void route_cache::entry::set(const route& r)
+{
+	negative_until = 0;
+	for (std::size_t i = 0; i < count; i++) {
+		if (routes[i].server == r.server && routes[i].af == r.af) {
+			routes[i] = r;
+			return;
+		}
+	}
+	if (count < routes.size()) {
+		routes[count++] = r;
+		return;
+	}
+	// Full; replace the stalest.
+	auto oldest = std::min_element(routes.begin(), routes.end(), [](const route& a, const route& b) { return a.updated < b.updated; });
+	*oldest = r;
+}
+
+void route_cache::entry::choose(const route_policy& policy)
+{
+	if (count == 0) return;
+
+	std::time_t newest = 0;
+	for (std::size_t i = 0; i < count; i++)
+		newest = std::max(newest, routes[i].updated);
+
+	best = 0;
+	for (std::size_t i = 1; i < count; i++)
+		if (policy.better(routes[i], routes[best], newest)) best = i;
+}
+
+bool route_policy::better(const route& a, const route& b, std::time_t newest) const
+{
+	bool fresh_a = newest - a.updated <= stale_after;
+	bool fresh_b = newest - b.updated <= stale_after;
+	if (fresh_a != fresh_b) return fresh_a;
+
+	if (prefer_ipv6 && a.af != b.af) return a.af == AF_INET6;
+
+	if (rank(a.server) != rank(b.server)) return rank(a.server) < rank(b.server);
+
+	return a.updated > b.updated;
+}
+
+std::string route_policy::encode() const
+{
+	std::string s(9 + 4 * server_rank.size(), '\0');
+	auto* b = reinterpret_cast<uint8_t*>(s.data());
+	b[0] = prefer_ipv6;
+	store_time(b + 1, stale_after);
+	for (std::size_t i = 0; i < server_rank.size(); i++) {
+		auto r = static_cast<uint32_t>(server_rank[i]);
+		for (int j = 0; j < 4; j++)
+			b[9 + 4 * i + j] = r >> (24 - 8 * j) & 0xFF;
+	}
+	return s;
+}
+
+std::optional<route_policy> route_policy::decode(std::string_view s)
+{
+	if (s.size() < 9 || (s.size() - 9) % 4 != 0) return std::nullopt;
+
+	auto* b = reinterpret_cast<const uint8_t*>(s.data());
+	route_policy p;
+	p.prefer_ipv6 = b[0] != 0;
+	p.stale_after = load_time(b + 1);
+	for (std::size_t i = 9; i < s.size(); i += 4) {
+		uint32_t r = 0;
+		for (int j = 0; j < 4; j++)
+			r = r << 8 | b[i + j];
+		p.server_rank.push_back(static_cast<int>(r));
+	}
+	return p;
+}
+
+// Only the zones that changed are re-ranked.
+void route_cache::apply(index& idx, const std::vector<change>& changes, const std::vector<dv::callsign>& expired, std::time_t now) const
+{
+	for (const auto& c : changes) {
+		if (!c.miss) {
+			auto& e = idx[c.zone];
+			e.set(c.r);
+			e.choose(policy_);
+			continue;
+		}
+		// A miss never hides a real route.
+		auto& e = idx[c.zone];
+		if (e.count == 0) e.negative_until = c.until;
+	}
+
+	// Unless a route or a later miss came in meanwhile.
+	for (const auto& zone : expired) {
+		auto it = idx.find(zone);
+		if (it != idx.end() && it->second.count == 0 && it->second.negative_until <= now) idx.erase(it);
+	}
+}
+
+// Left-right write: change the copy readers aren't on, switch readers
+// over, wait out the ones still on the old copy, then change that too.
+template<typename F>
+void route_cache::write(F&& f)
+{
+	std::lock_guard<std::mutex> lock(write_mutex_);
+
+	int cur = current_.load(std::memory_order_relaxed);
+	f(index_[1 - cur]);
+	current_.store(1 - cur, std::memory_order_seq_cst);
+
+	int v = version_.load(std::memory_order_relaxed);
+	while (readers_[1 - v].load(std::memory_order_acquire) != 0)
+		std::this_thread::yield();
+	version_.store(1 - v, std::memory_order_seq_cst);
+	while (readers_[v].load(std::memory_order_acquire) != 0)
+		std::this_thread::yield();
+
+	f(index_[cur]);
+}
+
+}// namespace ircddb
@@ -0,0 +1,181 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public
+// License along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef IRCDDB_ROUTE_CACHE_H
+#define IRCDDB_ROUTE_CACHE_H
+
+#include "common/lmdb++.h"
+#include "dv/callsign.h"
+#include "records.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ircddb {
+
+// One address a zone can be reached at, as learned from one IRC server.
+struct route {
+	uint8_t server;
+	uint8_t af;
+	std::time_t updated;
+	std::array<uint8_t, 16> addr;
+};
+
+// How to choose between a zone's candidates:
+// 1. Routes within stale_after of the freshest candidate beat older ones,
+//    so a gate that lost one address family falls back to the other.
+// 2. IPv6 beats IPv4, if prefer_ipv6.
+// 3. Servers with a lower server_rank win. Unlisted servers rank last.
+// 4. The most recently seen route wins.
+struct route_policy {
+	std::vector<int> server_rank;
+	bool prefer_ipv6 = true;
+	std::time_t stale_after = 30 * 60;
+
+	int rank(uint8_t server) const
+	{
+		return server < server_rank.size() ? server_rank[server] : std::numeric_limits<int>::max();
+	}
+
+	// Whether a should be used over b, given the freshest candidate.
+	bool better(const route& a, const route& b, std::time_t newest) const;
+
+	// Byte layout stored under route_policy_key so readers rank the same
+	// way: prefer_ipv6, stale_after, then one big-endian int per server.
+	std::string encode() const;
+	static std::optional<route_policy> decode(std::string_view s);
+};
+
+enum class route_status {
+	unknown, // not in the cache
+	hit,
+	negative,// recently looked up and not found anywhere
+};
+
+struct route_result {
+	static constexpr std::size_t max_routes = 4;
+
+	route_status status = route_status::unknown;
+	std::size_t count = 0;
+	std::array<route, max_routes> routes;// best first
+};
+
+// In-memory copy of the zone_ip4/zone_ip6 tables for the routing path.
+//
+// Two copies of the index are kept (left-right). Readers announce
+// themselves on a counter and read whichever copy is current, so lookup()
+// is wait-free and never sees a half-applied change. Changes are queued
+// with set() and note_miss() and applied to both copies by publish(),
+// which waits for readers of the old copy to leave before touching it.
+// Only one thread publishes at a time.
+class route_cache {
+public:
+	// How long a miss is remembered.
+	static constexpr std::time_t negative_ttl = 60;
+	static constexpr uint64_t all = std::numeric_limits<uint64_t>::max();
+
+	route_cache() = default;
+	route_cache(const route_cache&) = delete;
+	route_cache& operator=(const route_cache&) = delete;
+
+	route_result lookup(dv::callsign zone, std::time_t now) const;
+	// Just the chosen route; it is kept up to date as candidates change.
+	std::optional<route> best(dv::callsign zone) const;
+
+	// Re-ranks every zone.
+	void set_policy(const route_policy& policy);
+
+	void set(dv::callsign zone, int af, const gate_addr& a);
+	void note_miss(dv::callsign zone, std::time_t now);
+	// How many changes have been queued so far. publish() and discard()
+	// take such a mark to cover only the changes queued before it.
+	uint64_t mark() const;
+	void publish(uint64_t upto = all);
+	// Forgets queued changes, for when their records never made it to
+	// disk.
+	void discard(uint64_t upto = all);
+
+	// Forgets every zone.
+	void clear();
+	// Replaces the whole index with the contents of the tables.
+	void rebuild(lmdb::env& env, lmdb::dbi& zone_ip4, lmdb::dbi& zone_ip6);
+
+	std::size_t size() const;
+
+private:
+	struct entry {
+		std::time_t negative_until = 0;
+		uint8_t count = 0;
+		uint8_t best = 0;
+		std::array<route, route_result::max_routes> routes;
+
+		void set(const route& r);
+		void choose(const route_policy& policy);
+	};
+
+	using index = std::unordered_map<dv::callsign, entry>;
+
+	struct change {
+		dv::callsign zone;
+		bool miss;
+		std::time_t until;
+		route r;
+	};
+
+	std::vector<change> take(uint64_t upto);
+	void apply(index& idx, const std::vector<change>& changes, const std::vector<dv::callsign>& expired, std::time_t now) const;
+
+	template<typename F>
+	void write(F&& f);
+
+	std::array<index, 2> index_;
+	std::atomic<int> current_{0};
+	// Reader counters; readers use the one version_ names.
+	mutable std::array<std::atomic<long>, 2> readers_{};
+	std::atomic<int> version_{0};
+
+	// Guarded by write_mutex_.
+	std::mutex write_mutex_;
+	route_policy policy_;
+
+	mutable std::mutex pending_mutex_;
+	std::vector<change> pending_;
+	// Changes taken out of pending_ so far.
+	uint64_t taken_ = 0;
+
+	// Negative entries by expiry, oldest first. Guarded by
+	// pending_mutex_.
+	std::deque<std::pair<std::time_t, dv::callsign>> negatives_;
+};
+
+}// namespace ircddb
+
+#endif
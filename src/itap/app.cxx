@@ -40,7 +40,6 @@ namespace itap {
 
 app::app(const std::string& dgate_socket_path, const std::string& itap_tty_path, const std::string& cs, char module) : dgate::client(dgate_socket_path),  cs_(cs), itap_tty_path_(itap_tty_path), module_(module), itap_sock_(-1), ev_itap_readable_(loop_), ev_itap_ping_(loop_), ev_itap_timeout_(loop_), rand_gen_(getpid()), rand_dist_()
 {
-	cs_.resize(8, ' ');
 	ev_itap_readable_.set<app, &app::itap_readable>(this);
 	ev_itap_timeout_.set<app, &app::itap_timeout>(this);
 	ev_itap_ping_.set<app, &app::itap_ping>(this);
@@ -249,14 +248,11 @@ void app::itap_readable(ev::io&, int)
 
 		dgate::packet p;
 		auto h = msg->header;
-		if (std::memcmp(h.departure_rptr_cs, "DIRECT  ", 8) == 0) {
+		if (h.departure_rptr() == dv::callsign("DIRECT")) {
 			// Terminal Mode sets DIRECT for all transmissions.
 			// We have to re-write.
-			std::string rptr = cs_;
-			rptr[7] = module_;
-			std::memcpy(h.departure_rptr_cs, rptr.c_str(), 8);
-			rptr[7] = 'G';
-			std::memcpy(h.destination_rptr_cs, rptr.c_str(), 8);
+			cs_.with_module(module_).to_field(h.departure_rptr_cs);
+			cs_.with_module('G').to_field(h.destination_rptr_cs);
 			h.set_crc(h.calc_crc());
 		}
 		p.type = dgate::P_HEADER;
@@ -284,6 +280,7 @@ void app::itap_readable(ev::io&, int)
 		if (msg->voice.seqno & 0x40U) {
 			p.type = dgate::P_VOICE_END;
 			p.voice_end.bit_errors = 0;
+			p.voice_end.quality = {};
 			p.voice_end.count = msg->voice.count;
 			p.voice_end.id = tx_id_;
 			p.voice_end.f = msg->voice.f;
@@ -354,6 +351,8 @@ void app::send_from_queue()
 	case dgate::P_VOICE_END:
 		dgate_handle_voice(p, dgate::packet_voice_end_size);
 		break;
+	default:
+		break;
 	}
 }
 
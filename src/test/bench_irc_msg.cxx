@@ -0,0 +1,172 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+// Compares the IRC parser against the regex one it replaced, on a WHO
+// dump recorded from a server (one line per message, as received) or,
+// without one, a generated dump of the same shape.
+//
+//   bench_irc_msg [who_dump.txt]
+
+#include "ircddb/irc_msg.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+static const std::regex IRC_MSG_REGEX("^(?:\\:([A-Za-z0-9\\-.]+|[A-Za-z0-9\\-\\x5B-\\x60\\x7B-\\x7D]+(?:(?:![^\\0\\r\\n @]+)?@[A-Za-z0-9\\-.:]+)?) )?([A-Za-z]+|[0-9]{3})((?: [^\\0\\r\\n :][^\\0\\r\\n ]*){0,14})( :?[^\\0\\r\\n]*?)?\\r?\\n?$", std::regex_constants::ECMAScript | std::regex_constants::optimize);
+
+static const std::regex IRC_PFX_REGEX("^(?:([A-Za-z\\x5B-\\x60\\x7B-\\x7D][A-Za-z0-9\\-\\x5B-\\x60\\x7B-\\x7D]*)(?:(![^\\0\\r\\n @]+)?@([A-Za-z0-9\\-.:]+))?|([A-Za-z0-9\\-.:]+))$", std::regex_constants::ECMAScript | std::regex_constants::optimize);
+
+// The old irc_msg(const std::string&).
+static ircddb::irc_msg legacy_parse(const std::string& raw)
+{
+	ircddb::irc_msg m;
+	std::smatch base_match;
+	if (!std::regex_match(raw, base_match, IRC_MSG_REGEX, std::regex_constants::match_not_null)) {
+		m.command = IRCMESSAGE_INVALID;
+		return m;
+	}
+	if (base_match[1].matched) {
+		m.prefix = base_match[1];
+		std::smatch pfx_match;
+		if (std::regex_match(*m.prefix, pfx_match, IRC_PFX_REGEX, std::regex_constants::match_not_null)) {
+			ircddb::irc_prefix p;
+			if (pfx_match[4].matched) p.host = pfx_match[4];
+			if (pfx_match[3].matched) p.host = pfx_match[3];
+			if (pfx_match[2].matched) p.user = pfx_match[2].str().substr(1);
+			if (pfx_match[1].matched) p.nick = pfx_match[1];
+			m.pfx = p;
+		}
+	}
+	m.command = base_match[2];
+	if (m.command.size() == 3) m.code = std::stoi(m.command);
+
+	auto p = ircddb::irc_params();
+	if (base_match[3].matched) {
+		std::istringstream buf(base_match[3]);
+		std::string arg;
+		while (buf >> arg)
+			p.list.push_back(arg);
+	}
+	if (base_match[4].matched) {
+		auto trailer = base_match[4].str();
+		if (trailer.starts_with(' ')) trailer = trailer.substr(1);
+		if (trailer.starts_with(':')) trailer = trailer.substr(1);
+		p.trailer = trailer;
+	}
+	if (base_match[3].matched || base_match[4].matched) m.params = p;
+	return m;
+}
+
+static bool same(const ircddb::irc_msg& a, const ircddb::irc_msg& b)
+{
+	if (a.command != b.command || a.prefix != b.prefix || a.code != b.code) return false;
+	if (a.pfx.has_value() != b.pfx.has_value()) return false;
+	if (a.pfx && (a.pfx->nick != b.pfx->nick || a.pfx->user != b.pfx->user || a.pfx->host != b.pfx->host)) return false;
+	if (a.params.has_value() != b.params.has_value()) return false;
+	return !a.params || (a.params->list == b.params->list && a.params->trailer == b.params->trailer);
+}
+
+static std::string generate(int n)
+{
+	std::string dump;
+	for (int i = 0; i < n; i++) {
+		auto nick = "w" + std::to_string(i) + "abc-" + std::to_string(i % 10);
+		dump += ":rr.openquad.net 352 u-dgate #dstar " + std::to_string(i) + "ABC ";
+		dump += "2001:db8::" + std::to_string(i) + " rr.openquad.net " + nick + " H :0 dgate\r\n";
+		if (i % 50 == 0) dump += ":w" + std::to_string(i) + "abc-1!W" + std::to_string(i) + "ABC@198.51.100.7 JOIN :#dstar\r\n";
+	}
+	dump += ":rr.openquad.net 315 u-dgate #dstar :End of /WHO list.\r\n";
+	return dump;
+}
+
+template <typename F>
+static double time_ms(F&& f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	std::string dump;
+	if (argc > 1) {
+		std::ifstream in(argv[1], std::ios::binary);
+		std::stringstream s;
+		s << in.rdbuf();
+		dump = s.str();
+	}
+	else {
+		dump = generate(20000);
+	}
+
+	std::vector<std::string> lines;
+	for (size_t from = 0, to; (to = dump.find('\n', from)) != std::string::npos; from = to + 1)
+		lines.push_back(dump.substr(from, to - from + 1));
+
+	size_t mismatches = 0;
+	for (auto& l : lines)
+		if (!same(legacy_parse(l), ircddb::irc_msg(l))) mismatches++;
+
+	size_t sink = 0;
+	double legacy = time_ms([&] {
+		for (auto& l : lines)
+			sink += legacy_parse(l).command.size();
+	});
+
+	// What the client thread does now: views into the receive buffer.
+	std::string_view view = dump;
+	double views = time_ms([&] {
+		ircddb::irc_msg_view m;
+		for (size_t from = 0, to; (to = view.find('\n', from)) != std::string_view::npos; from = to + 1)
+			if (m.parse(view.substr(from, to - from + 1))) sink += m.param_count;
+	});
+
+	// Plus the copy for the app thread.
+	double owned = time_ms([&] {
+		ircddb::irc_msg_view m;
+		for (size_t from = 0, to; (to = view.find('\n', from)) != std::string_view::npos; from = to + 1)
+			if (m.parse(view.substr(from, to - from + 1))) sink += ircddb::irc_msg(m).command.size();
+	});
+
+	std::cout << lines.size() << " lines, " << mismatches << " parsed differently" << std::endl;
+	std::cout << "regex:     " << legacy << " ms" << std::endl;
+	std::cout << "view:      " << views << " ms (" << legacy / views << "x)" << std::endl;
+	std::cout << "view+copy: " << owned << " ms (" << legacy / owned << "x)" << std::endl;
+
+	return sink == 0;
+}
@@ -0,0 +1,63 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "common/byte_ring.h"
+#include <iostream>
+#include <string>
+
+int main()
+{
+	byte_ring<16> r;
+	char scratch[16];
+
+	r.write("PING :a\r\nPI", 11);
+	auto len = r.line();
+	std::cout << (len == 9) << (r.view(len, scratch) == "PING :a\r\n") << std::endl;
+	r.consume(len);
+	std::cout << (r.line() == 0) << (r.size() == 2) << std::endl;
+
+	// This line wraps around the end of the ring.
+	std::cout << r.write("NG :bcd\r\n", 9) << !r.write("0123456789", 10) << std::endl;
+	len = r.line();
+	auto v = r.view(len, scratch);
+	std::cout << (v == "PING :bcd\r\n") << (v.data() == scratch) << std::endl;
+
+	iovec iov[2]{};
+	std::cout << (r.data(iov) == 2) << (iov[0].iov_len + iov[1].iov_len == 11) << std::endl;
+	r.consume(len);
+	std::cout << r.empty() << (r.free(iov) == 2) << (iov[0].iov_len + iov[1].iov_len == 16) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,68 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+#include "dv/types.h"
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+static constexpr dv::callsign cq = "CQCQCQ";
+static_assert(cq[6] == ' ' && cq.module() == ' ');
+static_assert(dv::callsign("w1abc  b").upper() == dv::callsign("W1ABC  B"));
+static_assert(dv::callsign("W1ABC  B").base() == dv::callsign("W1ABC"));
+static_assert(dv::callsign("W1ABC").with_module('G').module() == 'G');
+static_assert(dv::callsign("XRF012AL").truncate(6) == dv::callsign("XRF012"));
+static_assert(dv::callsign("AB") < dv::callsign("B"));
+static_assert(dv::callsign().empty() && dv::callsign("W1ABC").length() == 5);
+
+int main()
+{
+	dv::header h;
+	std::memcpy(h.companion_cs, "CQCQCQ  ", 8);
+	std::memcpy(h.own_cs, "W1ABC  B", 8);
+
+	std::cout << (h.companion() == cq) << (h.own().str() == "W1ABC  B") << (h.own().trimmed() == "W1ABC  B") << (h.own().base().trimmed() == "W1ABC") << std::endl;
+
+	dv::callsign("W1ABC  A").to_field(h.destination_rptr_cs);
+	std::cout << (std::memcmp(h.destination_rptr_cs, "W1ABC  A", 8) == 0) << std::endl;
+
+	std::unordered_map<dv::callsign, int> m;
+	m["XRF012"] = 1;
+	m[h.own()] = 2;
+	std::cout << (m[dv::callsign("XRF012")] == 1) << (m["W1ABC  B"] == 2) << (m.size() == 2) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "dlink/dcs.h"
+#include <cstring>
+#include <iostream>
+
+using dlink::dcs_traits;
+
+static_assert(sizeof(dlink::dcs_packet_voice) == 100);
+static_assert(sizeof(dlink::dcs_packet_link) == 519);
+static_assert(sizeof(dlink::dcs_packet_link_ack) == 14);
+
+int main()
+{
+	dv::header h;
+	std::memset(&h, ' ', sizeof(h));
+	h.flags[0] = h.flags[1] = h.flags[2] = 0;
+	dv::callsign("DCS001 B").to_field(h.destination_rptr_cs);
+	dv::callsign("W1ABC  G").to_field(h.departure_rptr_cs);
+	dv::callsign("CQCQCQ").to_field(h.companion_cs);
+	dv::callsign("W1XYZ").to_field(h.own_cs);
+	h.set_crc(h.calc_crc());
+
+	dv::rf_frame f;
+	std::memset(&f, 0x55, sizeof(f));
+
+	// Any voice packet is enough to rebuild the header.
+	dlink::dcs_packet p;
+	auto len = dcs_traits::voice(p, h, 0x1234, 7, false, f, 0x010203);
+	std::cout << (len == 100) << (dcs_traits::classify(p, len) == dlink::K_VOICE) << std::endl;
+
+	auto r = dcs_traits::get_header(p);
+	std::cout << (std::memcmp(&r, &h, sizeof(h)) == 0) << r.verify() << (r.own() == dv::callsign("W1XYZ")) << std::endl;
+	std::cout << (dcs_traits::stream_id(p, dlink::K_VOICE) == 0x1234) << (dcs_traits::seqno(p) == 7) << !dcs_traits::is_end(p) << (p.voice.count[0] == 3 && p.voice.count[2] == 1) << std::endl;
+
+	dcs_traits::voice(p, h, 0x1234, 20, true, f, 4);
+	std::cout << dcs_traits::is_end(p) << (dcs_traits::seqno(p) == 20) << std::endl;
+
+	len = dcs_traits::heartbeat(p, "W1ABC", 'B', "DCS001 B");
+	std::cout << (dcs_traits::classify(p, len) == dlink::K_HEARTBEAT) << std::endl;
+
+	std::memcpy(p.ack.from, "W1ABC  B", 8);
+	p.ack.mod_from = 'B';
+	p.ack.mod_to = 'C';
+	std::memcpy(p.ack.ack, "NAK", 3);
+	p.ack.null = 0;
+	std::cout << (dcs_traits::classify(p, sizeof(dlink::dcs_packet_link_ack)) == dlink::K_NAK) << (dcs_traits::ack_module(p) == 'B') << std::endl;
+
+	len = dcs_traits::link(p, "W1ABC", 'B', 'C', "DCS001 C");
+	std::cout << (len == 519) << (std::memcmp(p.link.from, "W1ABC  B", 8) == 0) << (std::memcmp(p.link.to, "DCS001 C", 8) == 0) << std::endl;
+
+	return 0;
+}
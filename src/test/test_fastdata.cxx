@@ -0,0 +1,75 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "dv/stream.h"
+#include "dv/types.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main()
+{
+	dv::stream s;
+	for (int i = 0; i < 1000; i++) s.fast_data += (char)(i * 31 + 7);
+
+	s.prepare();
+
+	std::string out;
+	uint8_t buf[dv::fastdata_segment_size];
+	std::size_t i;
+	for (i = 0; i + 1 < s.frames.size();) {
+		if (i % 21 == 0) {
+			if (!s.frames[i].is_sync() && !s.frames[i].is_preend()) std::cout << "missing sync at " << i << std::endl;
+			i++;
+			continue;
+		}
+		auto len = dv::decode_fastdata(buf, &s.frames[i]);
+		if (len == 0) break;
+		out.append((const char*)buf, len);
+		i += 2;
+	}
+
+	std::cout << (out == s.fast_data) << std::endl;
+	std::cout << s.frames[s.frames.size() - 2].is_preend() << std::endl;
+	std::cout << s.frames[s.frames.size() - 1].is_end() << std::endl;
+
+	// Voice frames shouldn't look like fast data.
+	dv::rf_frame v[2];
+	uint8_t slow[3] = {dv::F_TXMSG, 'H', 'I'};
+	std::memcpy(v[0].ambe, dv::rf_ambe_null, 9);
+	dv::scram_data(v[0].data, slow);
+	v[1] = v[0];
+	std::cout << (dv::decode_fastdata(buf, v) == 0) << std::endl;
+}
@@ -0,0 +1,109 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "ircddb/gate_writer.h"
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+
+int main()
+{
+	const char* path = "/tmp/test_gate_writer.mdb";
+	std::remove(path);
+	std::remove("/tmp/test_gate_writer.mdb-lock");
+
+	auto env = std::make_shared<lmdb::env>(lmdb::env::create());
+	env->set_mapsize(1024UL * 1024UL);
+	env->open(path, MDB_NOSUBDIR);
+	auto db = std::make_shared<lmdb::dbi>();
+	{
+		auto wtxn = lmdb::txn::begin(*env);
+		*db = lmdb::dbi::open(wtxn, nullptr);
+		wtxn.commit();
+	}
+
+	std::atomic<int> published = 0, discarded = 0;
+	std::atomic<std::uint64_t> committed_mark = 0, dropped_mark = 0;
+	{
+		// A full batch goes out without waiting out the delay, and
+		// flush() doesn't wait for it either. Each commit hands on the
+		// highest mark in its batch.
+		ircddb::gate_writer w(env, 4, std::chrono::seconds(10));
+		w.on_commit([&](std::uint64_t mark) {
+			published++;
+			committed_mark = mark;
+		});
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < 4; i++)
+			w.put(db, "k" + std::to_string(i), "v" + std::to_string(i), i + 1);
+		while (w.records() < 4 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::cout << (w.records() == 4) << (w.commits() == 1) << (committed_mark == 4);
+
+		for (int i = 4; i < 10; i++)
+			w.put(db, "k" + std::to_string(i), "v" + std::to_string(i), i + 1);
+		bool ok = w.flush();
+		auto waited = std::chrono::steady_clock::now() - start;
+		std::cout << ok << (w.records() == 10) << (published == int(w.commits())) << (waited < std::chrono::seconds(5)) << (committed_mark == 10) << std::endl;
+
+		auto rtxn = lmdb::txn::begin(*env, nullptr, MDB_RDONLY);
+		std::string_view v;
+		std::cout << db->get(rtxn, std::string_view("k9"), v) << (v == "v9") << std::endl;
+		rtxn.abort();
+	}
+
+	{
+		// A batch that can't be committed is retried, then dropped
+		// without counting as written or publishing anything.
+		published = 0;
+		ircddb::gate_writer w(env, 4, std::chrono::milliseconds(10));
+		w.on_commit([&](std::uint64_t mark) {
+			published++;
+			committed_mark = mark;
+		});
+		w.on_drop([&](std::uint64_t mark) {
+			discarded++;
+			dropped_mark = mark;
+		});
+		w.put(db, "big", std::string(4 * 1024 * 1024, 'x'), 11);
+		std::cout << !w.flush() << (w.records() == 0) << (w.dropped() == 1) << (w.commits() == 0) << (published == 0) << (discarded == 1) << (dropped_mark == 11) << std::endl;
+
+		w.put(db, "small", "v", 12);
+		std::cout << w.flush() << (w.records() == 1) << (published == 1) << (committed_mark == 12) << std::endl;
+	}
+
+	std::remove(path);
+	std::remove("/tmp/test_gate_writer.mdb-lock");
+	return 0;
+}
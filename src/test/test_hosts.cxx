@@ -0,0 +1,85 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+#include "dlink/hosts.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+
+int main()
+{
+	const std::string text = "/tmp/test_hosts";
+	const std::string db = "/tmp/test_hosts.db";
+
+	FILE* f = std::fopen(text.c_str(), "w");
+	for (int i = 0; i < 10000; i++)
+		std::fprintf(f, "XRF%03d %d.%d.%d.%d\n", i % 1000, 10 + i / 1000, (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+	std::fprintf(f, "# comment\nxlx001 2001:db8::1\nbad not-an-address\n");
+	std::fclose(f);
+
+	auto start = std::chrono::steady_clock::now();
+	int count = dlink::host_db::compile(text, db);
+	auto mid = std::chrono::steady_clock::now();
+
+	dlink::host_db hosts;
+	bool loaded = hosts.load(db);
+	auto end = std::chrono::steady_clock::now();
+
+	std::cout << "compile " << std::chrono::duration<double, std::milli>(mid - start).count() << "ms, load " << std::chrono::duration<double, std::milli>(end - mid).count() << "ms" << std::endl;
+
+	// Duplicate names keep the last address.
+	std::cout << (count == 1001) << loaded << (hosts.size() == 1001) << std::endl;
+
+	auto e = hosts.find("XRF012");
+	auto ss = e->sockaddr(30001);
+	auto sin = reinterpret_cast<sockaddr_in*>(&ss);
+	char buf[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, &sin->sin_addr, buf, sizeof(buf));
+	std::cout << (std::string(buf) == "19.0.35.52") << (ntohs(sin->sin_port) == 30001) << std::endl;
+
+	e = hosts.find("XLX001");
+	std::cout << (e != nullptr && e->family == AF_INET6) << (hosts.find("XRF999 A") != nullptr) << (hosts.find("REF001") == nullptr) << std::endl;
+
+	// A bad file leaves the old table in place.
+	std::cout << !hosts.load(text) << (hosts.size() == 1001) << std::endl;
+
+	std::remove(text.c_str());
+	std::remove(db.c_str());
+	return 0;
+}
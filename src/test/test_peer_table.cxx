@@ -0,0 +1,97 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+#include "common/c++sock.h"
+#include <iostream>
+#include <map>
+#include <random>
+
+static sockaddr_storage v4(uint32_t ip, uint16_t port)
+{
+	sockaddr_storage ss = {};
+	auto sin = reinterpret_cast<sockaddr_in*>(&ss);
+	sin->sin_family = AF_INET;
+	sin->sin_addr.s_addr = htonl(ip);
+	sin->sin_port = htons(port);
+	return ss;
+}
+
+int main()
+{
+	// The same host over v4 and v4-mapped v6 is one peer.
+	sockaddr_storage a = v4(0x7F000001, 30001);
+	sockaddr_storage b = {};
+	auto sin6 = reinterpret_cast<sockaddr_in6*>(&b);
+	sin6->sin6_family = AF_INET6;
+	inet_pton(AF_INET6, "::ffff:127.0.0.1", &sin6->sin6_addr);
+	sin6->sin6_port = htons(30001);
+
+	std::cout << (peer_key(a) == peer_key(b)) << (peer_key(a) != peer_key(v4(0x7F000001, 30002))) << (peer_key(a) != peer_key(v4(0x7F000002, 30001))) << std::endl;
+
+	// Random inserts and erases against std::map.
+	peer_table<int> table;
+	std::map<std::pair<uint32_t, uint16_t>, int> ref;
+	std::mt19937 gen(1);
+	bool ok = true;
+
+	for (int i = 0; i < 200000; i++) {
+		uint32_t ip = gen() % 512;
+		uint16_t port = 30001 + gen() % 4;
+		peer_key k(v4(ip, port));
+
+		switch (gen() % 3) {
+		case 0:
+			table[k] = i;
+			ref[{ip, port}] = i;
+			break;
+		case 1:
+			ok &= table.erase(k) == (ref.erase({ip, port}) == 1);
+			break;
+		case 2: {
+			auto v = table.find(k);
+			auto it = ref.find({ip, port});
+			ok &= (v == nullptr) == (it == ref.end());
+			if (v != nullptr && it != ref.end()) ok &= *v == it->second;
+		} break;
+		}
+	}
+
+	size_t n = 0;
+	table.for_each([&](const peer_key&, int) { n++; });
+	std::cout << ok << (table.size() == ref.size()) << (n == ref.size()) << std::endl;
+
+	return 0;
+}
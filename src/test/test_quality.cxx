@@ -0,0 +1,72 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+#include "dgate/quality.h"
+#include <iostream>
+
+int main()
+{
+	dgate::quality_meter q;
+	q.start(100.0);
+
+	// A clean superframe, on time.
+	for (int i = 0; i < 21; i++) {
+		q.arrival(100.0 + 0.02 * i, 0);
+		q.decoded(0);
+	}
+
+	auto s = q.summary();
+	std::cout << (s.frames == 21) << (s.lost == 0) << (s.late == 0) << (s.jitter_us == 0) << (s.ber == 0) << std::endl;
+
+	// Two frames lost, then one arriving 100ms late.
+	q.arrival(100.0 + 0.02 * 23, 2);
+	q.decoded(4);
+	q.arrival(100.0 + 0.02 * 24 + 0.1, 0);
+	q.decoded(0);
+	q.sync_miss();
+
+	s = q.summary();
+	std::cout << (s.lost == 2) << (s.late == 1) << (s.sync_miss == 1) << (s.jitter_us > 0) << (s.bit_errors == 4) << (s.ber > 0) << std::endl;
+
+	// A reordered frame counts as late, not as most of a superframe lost.
+	q.arrival(100.0 + 0.02 * 25, dgate::seqno_gap(5, 4));
+	s = q.summary();
+	std::cout << (s.lost == 2) << (s.late == 2) << std::endl;
+
+	std::cout << (dgate::prev_seqno(0) == 20) << (dgate::seqno_gap(20, 1) == 2) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "common/lmdb++.h"
+#include "ircddb/records.h"
+#include <iostream>
+
+int main()
+{
+	ircddb::gate_addr a;
+	std::cout << a.set(2, 1700000000, AF_INET, "44.1.2.3") << (a.server == 2) << (a.time() == 1700000000) << std::endl;
+	std::cout << (a.addr[0] == 44 && a.addr[3] == 3 && a.addr[4] == 0) << !a.set(2, 0, AF_INET, "not-an-ip") << std::endl;
+
+	ircddb::gate_addr b;
+	std::cout << b.set(0, 1, AF_INET6, "2001:db8::1") << (b.addr[0] == 0x20 && b.addr[15] == 1) << std::endl;
+
+	// Viewed in place, as a reader would from the memory map.
+	auto v = lmdb::view_from_sv<ircddb::gate_addr>(lmdb::to_sv(a));
+	std::cout << (v == &a) << (sizeof(ircddb::gate_addr) == 25) << std::endl;
+
+	auto k = ircddb::zone_key::make(dv::callsign("KO6JXH"));
+	std::cout << (std::string_view(k.zone, 8) == "KO6JXH  ") << (k.callsign() == dv::callsign("KO6JXH")) << std::endl;
+	std::cout << (sizeof(ircddb::nick_key) == 9) << std::endl;
+
+	// A recent update only skips the WHO if the last WHO is recent too.
+	std::time_t now = 1700000000;
+	std::cout << ircddb::snapshot_fresh(now - 60, now - 3600, now) << !ircddb::snapshot_fresh(now - 60, 0, now) << std::endl;
+	std::cout << !ircddb::snapshot_fresh(now - ircddb::max_snapshot_age, now - 3600, now) << !ircddb::snapshot_fresh(now - 60, now - ircddb::max_full_sync_age, now) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "common/ring_queue.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main()
+{
+	// Bounded, FIFO, move-only friendly.
+	spsc_queue<std::unique_ptr<int>, 4> s;
+	for (int i = 0; i < 4; i++)
+		s.try_push(std::make_unique<int>(i));
+	std::cout << !s.try_push(std::make_unique<int>(4)) << (**s.try_pop() == 0) << std::endl;
+
+	std::unique_ptr<int> out[8];
+	std::cout << (s.try_pop_bulk(out, 8) == 3) << (*out[2] == 3) << s.empty() << std::endl;
+
+	// One producer thread: everything arrives, in order.
+	spsc_queue<int, 64> sq;
+	std::thread sp([&]() {
+		for (int i = 0; i < 100000; i++)
+			while (!sq.try_push(int(i)))
+				std::this_thread::yield();
+	});
+	bool ordered = true;
+	int buf[16];
+	for (int next = 0; next < 100000;) {
+		auto n = sq.try_pop_bulk(buf, 16);
+		if (n == 0) std::this_thread::yield();
+		for (std::size_t i = 0; i < n; i++)
+			ordered &= buf[i] == next++;
+	}
+	sp.join();
+	std::cout << ordered << std::endl;
+
+	// Four producers: everything arrives once, in order per producer.
+	mpsc_queue<int, 128> mq;
+	std::vector<std::thread> producers;
+	for (int p = 0; p < 4; p++)
+		producers.emplace_back([&, p]() {
+			for (int i = 0; i < 50000; i++)
+				while (!mq.try_push(p << 24 | i))
+					std::this_thread::yield();
+		});
+	int last[4] = {-1, -1, -1, -1};
+	int total = 0;
+	ordered = true;
+	while (total < 200000) {
+		auto n = mq.try_pop_bulk(buf, 16);
+		if (n == 0) std::this_thread::yield();
+		for (std::size_t i = 0; i < n; i++) {
+			int p = buf[i] >> 24, v = buf[i] & 0xFFFFFF;
+			ordered &= v == last[p] + 1;
+			last[p] = v;
+		}
+		total += n;
+	}
+	for (auto& t : producers)
+		t.join();
+	std::cout << ordered << mq.empty() << std::endl;
+
+	// A burst wakes the consumer once, and nothing is left behind.
+	ev::dynamic_loop loop;
+	ev::async wake(loop);
+	signalled_queue<mpsc_queue<std::string, 1024>> q;
+	q.set_signal(&wake);
+	int wakeups = 0, got = 0;
+	struct handler {
+		signalled_queue<mpsc_queue<std::string, 1024>>* q;
+		int* wakeups;
+		int* got;
+		ev::dynamic_loop* loop;
+		void operator()(ev::async&, int)
+		{
+			(*wakeups)++;
+			q->drain([&](std::string&) { (*got)++; });
+			if (*got == 1000) loop->break_loop();
+		}
+	} h{&q, &wakeups, &got, &loop};
+	wake.set(&h);
+	wake.start();
+	std::thread burst([&]() {
+		for (int i = 0; i < 1000; i++)
+			q.push(std::to_string(i));
+	});
+	loop.run();
+	burst.join();
+	std::cout << (got == 1000) << (wakeups < 1000) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "ircddb/route_cache.h"
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+static ircddb::gate_addr addr(int server, std::time_t t, const char* ip)
+{
+	ircddb::gate_addr a;
+	a.set(server, t, AF_INET, ip);
+	return a;
+}
+
+int main()
+{
+	ircddb::route_cache c;
+	dv::callsign zone("KO6JXH");
+
+	std::cout << (c.lookup(zone, 0).status == ircddb::route_status::unknown) << std::endl;
+
+	// Queued changes are invisible until published.
+	c.set(zone, AF_INET, addr(0, 100, "10.0.0.1"));
+	std::cout << (c.lookup(zone, 0).status == ircddb::route_status::unknown);
+	c.publish();
+	auto r = c.lookup(zone, 0);
+	std::cout << (r.status == ircddb::route_status::hit) << (r.count == 1) << (r.routes[0].addr[3] == 1) << std::endl;
+
+	// Same server replaces, another server adds.
+	c.set(zone, AF_INET, addr(0, 200, "10.0.0.2"));
+	c.set(zone, AF_INET, addr(1, 150, "10.0.0.3"));
+	c.publish();
+	r = c.lookup(zone, 0);
+	std::cout << (r.count == 2) << (r.routes[0].updated == 200) << (r.routes[1].server == 1) << std::endl;
+
+	// Misses are remembered for a while, and never hide a route.
+	dv::callsign gone("N0CALL");
+	c.note_miss(gone, 1000);
+	c.note_miss(zone, 1000);
+	c.publish();
+	std::cout << (c.lookup(gone, 1001).status == ircddb::route_status::negative);
+	std::cout << (c.lookup(gone, 1000 + ircddb::route_cache::negative_ttl).status == ircddb::route_status::unknown);
+	std::cout << (c.lookup(zone, 1001).status == ircddb::route_status::hit) << std::endl;
+
+	// Expired misses are dropped when a later one is published.
+	auto before = c.size();
+	dv::callsign none("N0NE");
+	c.note_miss(none, 1000 + ircddb::route_cache::negative_ttl);
+	c.publish();
+	std::cout << (c.size() == before) << (c.lookup(none, 1061).status == ircddb::route_status::negative) << (c.lookup(zone, 1061).status == ircddb::route_status::hit) << std::endl;
+
+	// A dual-stack gate is reached over IPv6, unless its IPv6 route has
+	// gone stale.
+	dv::callsign dual("W1AW");
+	ircddb::gate_addr v6;
+	v6.set(1, 5000, AF_INET6, "2001:db8::1");
+	c.set(dual, AF_INET, addr(0, 5100, "10.0.1.1"));
+	c.set(dual, AF_INET6, v6);
+	c.publish();
+	std::cout << (c.best(dual)->af == AF_INET6) << (c.lookup(dual, 0).routes[0].af == AF_INET6);
+	c.set(dual, AF_INET, addr(0, 5000 + 2 * 3600, "10.0.1.1"));
+	c.publish();
+	std::cout << (c.best(dual)->af == AF_INET) << std::endl;
+
+	// Server rank decides between fresh routes of the same family.
+	dv::callsign two("K2ABC");
+	c.set(two, AF_INET, addr(0, 100, "10.0.2.1"));
+	c.set(two, AF_INET, addr(1, 90, "10.0.2.2"));
+	c.publish();
+	std::cout << (c.best(two)->server == 0);
+	ircddb::route_policy policy;
+	policy.server_rank = {1, 0};
+	c.set_policy(policy);
+	std::cout << (c.best(two)->server == 1) << !c.best(gone) << std::endl;
+
+	// Publishing up to a mark leaves later changes queued, and those
+	// can be discarded on their own.
+	dv::callsign first("K3AAA"), second("K3BBB"), third("K3CCC");
+	c.set(first, AF_INET, addr(0, 100, "10.0.3.1"));
+	auto m1 = c.mark();
+	c.set(second, AF_INET, addr(0, 100, "10.0.3.2"));
+	auto m2 = c.mark();
+	c.set(third, AF_INET, addr(0, 100, "10.0.3.3"));
+	c.publish(m1);
+	std::cout << c.best(first).has_value() << !c.best(second) << !c.best(third);
+	c.discard(m2);
+	c.publish();
+	std::cout << !c.best(second) << c.best(third).has_value() << std::endl;
+
+	// Readers keep going while the writer publishes, and always see a
+	// whole entry.
+	dv::callsign busy("KO6BSY");
+	c.set(busy, AF_INET, addr(0, 1, "10.0.0.1"));
+	c.publish();
+	std::atomic_bool stop = false;
+	std::atomic_bool torn = false;
+	std::thread reader([&]() {
+		while (!stop) {
+			auto x = c.lookup(busy, 0);
+			if (x.status != ircddb::route_status::hit || x.routes[0].updated != x.routes[0].addr[3]) torn = true;
+		}
+	});
+	for (int i = 2; i < 250; i++) {
+		auto a = addr(0, i, ("10.0.0." + std::to_string(i)).c_str());
+		c.set(busy, AF_INET, a);
+		c.set(dv::callsign("W" + std::to_string(i)), AF_INET, a);
+		c.publish();
+	}
+	stop = true;
+	reader.join();
+	std::cout << !torn << (c.size() == 255) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "dgate/routes.h"
+#include "ircddb/records.h"
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <sys/socket.h>
+
+static void add(lmdb::env& env, lmdb::dbi& db, const char* zone, int server, std::time_t t, int af, const char* ip)
+{
+	ircddb::gate_addr a;
+	a.set(server, t, af, ip);
+	auto wtxn = lmdb::txn::begin(env);
+	db.put(wtxn, lmdb::to_sv(ircddb::zone_key::make(dv::callsign(zone))), lmdb::to_sv(a));
+	wtxn.commit();
+}
+
+int main()
+{
+	const char* path = "/tmp/test_routes.mdb";
+	std::remove(path);
+	std::remove("/tmp/test_routes.mdb-lock");
+
+	auto env = std::make_shared<lmdb::env>(lmdb::env::create());
+	env->set_mapsize(1024UL * 1024UL);
+	env->set_max_dbs(3);
+	env->open(path, MDB_NOSUBDIR | MDB_NOTLS);
+	auto zone_ip4 = std::make_shared<lmdb::dbi>();
+	auto zone_ip6 = std::make_shared<lmdb::dbi>();
+	auto irc_sync = std::make_shared<lmdb::dbi>();
+	{
+		auto wtxn = lmdb::txn::begin(*env);
+		*zone_ip4 = lmdb::dbi::open(wtxn, "zone_ip4", MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED);
+		*zone_ip6 = lmdb::dbi::open(wtxn, "zone_ip6", MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED);
+		*irc_sync = lmdb::dbi::open(wtxn, "irc_sync", MDB_CREATE);
+		wtxn.commit();
+	}
+
+	auto now = std::time(nullptr);
+	ircddb::route_policy policy;
+	policy.server_rank = {1, 0};
+	policy.stale_after = 10 * 60;
+	auto p = ircddb::route_policy::decode(policy.encode());
+	std::cout << (p && p->server_rank == policy.server_rank && p->stale_after == policy.stale_after && p->prefer_ipv6) << !ircddb::route_policy::decode("short") << std::endl;
+
+	dgate::route_reader routes(env, zone_ip4, zone_ip6, irc_sync);
+	dgate::route_addr out[dgate::max_route_addrs];
+
+	// The tables list server 0 first; the policy ircddb stored after the
+	// reader started ranks server 1 first.
+	{
+		auto wtxn = lmdb::txn::begin(*env);
+		irc_sync->put(wtxn, ircddb::route_policy_key, policy.encode());
+		wtxn.commit();
+	}
+	add(*env, *zone_ip4, "K2ABC", 0, now, AF_INET, "10.0.0.1");
+	add(*env, *zone_ip4, "K2ABC", 1, now, AF_INET, "10.0.0.2");
+	std::cout << (routes.lookup(dv::callsign("k2abc  B"), out) == 2) << (out[0].server == 1) << (out[0].family == 4) << (out[0].addr[3] == 2) << std::endl;
+
+	// A stale IPv6 route loses to a fresh IPv4 one, though IPv6 is read
+	// first.
+	add(*env, *zone_ip6, "W1AW", 0, now - 2 * policy.stale_after, AF_INET6, "2001:db8::1");
+	add(*env, *zone_ip4, "W1AW", 0, now, AF_INET, "10.0.1.1");
+	std::cout << (routes.lookup(dv::callsign("W1AW"), out) == 2) << (out[0].family == 4) << (out[1].family == 6) << std::endl;
+
+	// What ircddb commits later is seen by the next query.
+	add(*env, *zone_ip6, "W1AW", 0, now, AF_INET6, "2001:db8::1");
+	std::cout << (routes.lookup(dv::callsign("W1AW"), out) == 2) << (out[0].family == 6) << (out[0].updated == now) << std::endl;
+
+	// A miss is remembered, but doesn't hide a gate that shows up later.
+	std::cout << (routes.lookup(dv::callsign("N0CALL"), out) == 0) << (routes.lookup(dv::callsign("N0CALL"), out) == 0);
+	add(*env, *zone_ip4, "N0CALL", 0, now, AF_INET, "10.0.2.1");
+	std::cout << (routes.lookup(dv::callsign("N0CALL"), out) == 1) << std::endl;
+
+	std::remove(path);
+	std::remove("/tmp/test_routes.mdb-lock");
+	return 0;
+}
@@ -0,0 +1,109 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "dv/slow_header.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Splits data into F_HEADER segments the way a radio does.
+static std::vector<dv::rf_frame> encode(const uint8_t* data, size_t len, uint8_t first_seqno)
+{
+	std::vector<uint8_t> slow;
+	for (size_t i = 0; i < len; i += 5) {
+		size_t n = std::min<size_t>(5, len - i);
+		slow.push_back(dv::F_HEADER | n);
+		slow.insert(slow.end(), data + i, data + i + n);
+		slow.resize(slow.size() + 5 - n, dv::F_EMPTY);
+	}
+
+	std::vector<dv::rf_frame> out;
+	uint8_t seqno = first_seqno;
+	for (size_t i = 0; i < slow.size();) {
+		dv::rf_frame f;
+		std::memset(&f, 0, sizeof(f));
+		if (seqno != 0) {
+			dv::scram_data(f.data, &slow[i]);
+			i += 3;
+		}
+		out.push_back(f);
+		seqno = (seqno + 1) % 21;
+	}
+	return out;
+}
+
+int main()
+{
+	dv::header h;
+	std::memset(&h, ' ', sizeof(h));
+	h.flags[0] = h.flags[1] = h.flags[2] = 0;
+	dv::callsign("XRF012 A").to_field(h.destination_rptr_cs);
+	dv::callsign("XRF012 G").to_field(h.departure_rptr_cs);
+	dv::callsign("CQCQCQ").to_field(h.companion_cs);
+	dv::callsign("W1XYZ").to_field(h.own_cs);
+	h.set_crc(h.calc_crc());
+
+	// Sent twice, joined part way through the first copy.
+	uint8_t twice[2 * sizeof(h)];
+	std::memcpy(twice, &h, sizeof(h));
+	std::memcpy(twice + sizeof(h), &h, sizeof(h));
+
+	auto frames = encode(twice, sizeof(twice), 1);
+
+	dv::slow_header d;
+	d.reset();
+	dv::header r;
+	int found = -1;
+	for (size_t i = 6; i < frames.size(); i++) {
+		uint8_t seqno = (1 + i) % 21;
+		if (d.add(seqno, frames[i], r)) {
+			found = i;
+			break;
+		}
+	}
+
+	std::cout << (found > 0) << (std::memcmp(&r, &h, sizeof(h)) == 0) << std::endl;
+
+	// A damaged copy isn't accepted.
+	frames = encode(reinterpret_cast<const uint8_t*>(&h), sizeof(h), 1);
+	frames[4].data[0] ^= 0x01;
+	d.reset();
+	bool ok = false;
+	for (size_t i = 0; i < frames.size(); i++)
+		ok |= d.add((1 + i) % 21, frames[i], r);
+	std::cout << !ok << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,238 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "dv/aprs.h"
+#include "dv/stream.h"
+#include "dv/types.h"
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+// stream::prepare() as it was before stream_encoder, kept here as the
+// reference. The only change is that null padding frames start out with
+// null slow data instead of whatever was on the stack.
+static void legacy_prepare(dv::stream& s)
+{
+	int seqno = 0;
+	bool msg_sent = false;
+	bool serial_sent = false;
+
+	int msg_idx = 0;
+	std::string::size_type serial_idx = 0;
+
+	std::vector<dv::rf_frame>::size_type min_frames = 0;
+
+	if (!s.tx_msg.empty()) {
+		s.tx_msg.resize(20, ' ');
+		min_frames += 8;
+	}
+	else {
+		msg_sent = true;
+	}
+
+	if (!s.serial_data.empty()) {
+		min_frames += ((s.serial_data.size() + (5 - 1)) / 5) * 2;
+	}
+	else {
+		serial_sent = true;
+	}
+
+	int num_syncs = ((min_frames + (20 - 1)) / 20);
+	if (s.d_sql) {
+		min_frames += num_syncs * 2;
+	}
+	min_frames += num_syncs;
+
+	auto& frames = s.frames;
+	if (frames.size() > 0 && frames[frames.size() - 1].is_end()) frames.pop_back();
+	std::optional<dv::rf_frame> preend_voice = {};
+
+	auto cur_size = frames.size();
+	if (cur_size > min_frames) {
+		cur_size = cur_size % 21;
+		if (cur_size > 0) cur_size = cur_size - 1;
+		if (cur_size % 2 == 1) {
+			preend_voice = frames[frames.size() - 1];
+			frames.pop_back();
+		}
+	}
+	else if (cur_size < min_frames) {
+		dv::rf_frame f;
+		std::memcpy(&f.ambe, dv::rf_ambe_null, sizeof(f.ambe));
+		std::memcpy(&f.data, dv::rf_data_null, sizeof(f.data));
+		frames.resize(min_frames, f);
+	}
+
+	int previous = 1;// 0 is for message, 1 is for serial
+
+	uint8_t buf[3];
+	for (std::vector<dv::rf_frame>::size_type i = 0; i < frames.size(); i++) {
+		if (seqno == 0) {
+			std::memcpy(frames[i].data, dv::rf_data_sync, 3);
+		}
+		else if (s.d_sql && seqno == 1) {
+			buf[0] = dv::F_DSQL | 0x02U;
+			buf[1] = *s.d_sql & 0xFFU;
+			buf[2] = (*s.d_sql >> 8) & 0xFFU;
+			dv::scram_data(frames[i].data, buf);
+		}
+		else if (s.d_sql && seqno == 2) {
+			std::memcpy(frames[i].data, dv::rf_data_null, 3);
+		}
+		else if (seqno % 2 == 1) {
+			if (!serial_sent && (msg_sent || previous == 0)) {
+				uint8_t tosend = std::min<std::string::size_type>(s.serial_data.size() - serial_idx, 5);
+				buf[0] = dv::F_DATA | (tosend & 0x0FU);
+				buf[1] = s.serial_data[serial_idx];
+				buf[2] = (tosend > 1 ? s.serial_data[serial_idx + 1] : 0x66U);
+				dv::scram_data(frames[i].data, buf);
+			}
+			else if (!s.tx_msg.empty() && (serial_sent || previous == 1)) {
+				buf[0] = dv::F_TXMSG | msg_idx;
+				buf[1] = s.tx_msg[msg_idx * 5];
+				buf[2] = s.tx_msg[msg_idx * 5 + 1];
+				dv::scram_data(frames[i].data, buf);
+			}
+		}
+		else {
+			if (!serial_sent && (msg_sent || previous == 0)) {
+				uint8_t tosend = std::min<std::string::size_type>(s.serial_data.size() - serial_idx, 5);
+				buf[0] = (tosend > 2 ? s.serial_data[serial_idx + 2] : 0x66U);
+				buf[1] = (tosend > 3 ? s.serial_data[serial_idx + 3] : 0x66U);
+				buf[2] = (tosend > 4 ? s.serial_data[serial_idx + 4] : 0x66U);
+				dv::scram_data(frames[i].data, buf);
+				serial_idx += tosend;
+				if (serial_idx >= s.serial_data.size()) serial_sent = true;
+				previous = 1;
+			}
+			else if (!s.tx_msg.empty() && (serial_sent || previous == 1)) {
+				buf[0] = s.tx_msg[msg_idx * 5 + 2];
+				buf[1] = s.tx_msg[msg_idx * 5 + 3];
+				buf[2] = s.tx_msg[msg_idx * 5 + 4];
+				dv::scram_data(frames[i].data, buf);
+				msg_idx++;
+				if (msg_idx == 4) {
+					msg_sent = true;
+					msg_idx = 0;
+				}
+				previous = 0;
+			}
+		}
+
+		seqno = (seqno + 1) % 21;
+	}
+
+	dv::rf_frame f;
+	std::memcpy(f.data, dv::rf_data_preend, 3);
+	if (preend_voice) {
+		std::memcpy(f.ambe, preend_voice->ambe, 9);
+		frames.push_back(f);
+	}
+	else if (frames[frames.size() - 1].is_sync()) {
+		std::memcpy(frames[frames.size() - 1].data, dv::rf_data_preend, 3);
+	}
+	else {
+		std::memcpy(f.ambe, dv::rf_ambe_null, 9);
+		frames.push_back(f);
+	}
+
+	std::memcpy(f.ambe, dv::rf_ambe_end, 9);
+	f.data[0] = 0;
+	f.data[1] = 0;
+	f.data[2] = 0;
+	frames.push_back(f);
+}
+
+// Voice frames with junk data, plus an end frame like a recording would
+// have.
+static dv::stream make_stream(int voice, bool slow_data)
+{
+	dv::stream s;
+	if (slow_data) {
+		s.tx_msg = "STREAMING";
+		s.serial_data = "$$CRC1234,KO6JXH-7>API52,DSTAR*:!3241.78N/11703.84W[/TESTING APRS\r";
+		s.d_sql = 0x0042;
+	}
+	for (int i = 0; i < voice; i++) {
+		dv::rf_frame f;
+		for (int j = 0; j < 9; j++) f.ambe[j] = i + j;
+		f.data[0] = i;
+		f.data[1] = i * 3;
+		f.data[2] = i * 7;
+		s.frames.push_back(f);
+	}
+	dv::rf_frame end;
+	std::memcpy(end.ambe, dv::rf_ambe_end, 9);
+	std::memset(end.data, 0, 3);
+	s.frames.push_back(end);
+	return s;
+}
+
+// Runs s through the encoder one frame at a time and compares the result
+// with the legacy muxer.
+static void check(const dv::stream& s)
+{
+	dv::stream expected = s;
+	legacy_prepare(expected);
+
+	dv::stream_encoder enc(s.tx_msg, s.serial_data, s.d_sql);
+	std::vector<dv::rf_frame> out;
+
+	bool first_early = false;
+	for (std::size_t i = 0; i < s.frames.size(); i++) {
+		if (auto f = enc.push(s.frames[i])) {
+			if (out.empty() && i == 1) first_early = true;
+			out.push_back(*f);
+		}
+	}
+	enc.finish();
+	while (auto f = enc.next()) out.push_back(*f);
+
+	std::cout << (first_early || s.frames.size() < 3) << enc.done() << (out.size() == expected.frames.size());
+	std::cout << (std::memcmp(out.data(), expected.frames.data(), out.size() * sizeof(dv::rf_frame)) == 0) << out.back().is_end() << std::endl;
+}
+
+int main()
+{
+	// Even and odd lengths, the latter reusing the last voice frame as
+	// the pre-end frame.
+	check(make_stream(250, true));
+	check(make_stream(251, true));
+	// Too short for the slow data: padded with null frames.
+	check(make_stream(5, true));
+	// No slow data to mux at all.
+	check(make_stream(230, false));
+}
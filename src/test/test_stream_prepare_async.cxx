@@ -0,0 +1,102 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "dv/prepare_pool.h"
+#include "dv/stream.h"
+#include "dv/types.h"
+#include <cstring>
+#include <ev++.h>
+#include <iostream>
+
+struct waiter {
+	dv::prepare_pool* pool;
+	uint64_t id;
+	std::optional<dv::stream> result;
+
+	void done(ev::async& w, int)
+	{
+		result = pool->take(id);
+		if (result) w.loop.break_loop(ev::ALL);
+	}
+};
+
+int main()
+{
+	dv::stream s;
+	std::memset(&s.header, 0, sizeof(s.header));
+	std::memcpy(s.header.destination_rptr_cs, "KO6JXH C", 8);
+	std::memcpy(s.header.departure_rptr_cs, "KO6JXH G", 8);
+	std::memcpy(s.header.companion_cs, "CQCQCQ  ", 8);
+	std::memcpy(s.header.own_cs, "KO6JXH  ", 8);
+	std::memcpy(s.header.own_cs_ext, "ECHO", 4);
+	s.header.set_crc(s.header.calc_crc());
+
+	dv::rf_frame f;
+	std::memcpy(f.ambe, dv::rf_ambe_null, 9);
+	std::memcpy(f.data, dv::rf_data_null, 3);
+	s.frames.resize(1500, f);// 30 seconds
+	s.tx_msg = "ASYNC TEST";
+	s.serial_data = "some serial data that takes a few segments";
+	s.d_sql = 0x1234;
+
+	dv::stream expected = s;
+	expected.prepare();
+
+	ev::dynamic_loop loop;
+	ev::async async(loop);
+
+	dv::prepare_pool pool(2, 4);
+
+	// The watcher has to be active before anything can signal it.
+	waiter w{&pool, 0, {}};
+	async.set<waiter, &waiter::done>(&w);
+	async.start();
+
+	// A cancelled job should never be delivered.
+	dv::stream other = s;
+	auto cancelled = pool.submit(std::move(other), &async);
+	std::cout << (cancelled && pool.cancel(*cancelled)) << std::endl;
+
+	auto id = pool.submit(std::move(s), &async);
+	if (!id) return 1;
+	w.id = *id;
+
+	loop.run();
+
+	if (!w.result) return 1;
+	std::cout << (w.result->frames.size() == expected.frames.size()) << std::endl;
+	std::cout << (std::memcmp(w.result->frames.data(), expected.frames.data(), expected.frames.size() * sizeof(dv::rf_frame)) == 0) << std::endl;
+	std::cout << (!pool.take(*cancelled)) << std::endl;
+}
@@ -0,0 +1,69 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "dlink/timing.h"
+#include <iostream>
+
+int main()
+{
+	dlink::link_timing t;
+	t.reset();
+	std::cout << (t.timeout() == dlink::link_timing::initial_timeout) << std::endl;
+
+	t.request(10.);
+	t.ack(10.04);
+	std::cout << t.have_rtt << (t.srtt > 0.039 && t.srtt < 0.041) << (t.rtt_hist[5] == 1) << std::endl;
+
+	// A close reflector with a steady 1 s heartbeat times out well
+	// under the old five seconds.
+	double now = 11.;
+	for (int i = 0; i < 20; i++) {
+		t.heard(now);
+		now += i % 2 ? 1.01 : 0.99;
+	}
+	std::cout << (t.interval > 0.98 && t.interval < 1.02) << (t.timeout() > 3. && t.timeout() < 4.) << std::endl;
+
+	// A far one with a slow, jittery heartbeat gets more room.
+	dlink::link_timing f;
+	f.reset();
+	now = 0.;
+	for (int i = 0; i < 20; i++) {
+		f.heard(now);
+		now += i % 2 ? 3.5 : 6.5;
+	}
+	std::cout << (f.timeout() > 15.) << (f.timeout() <= dlink::link_timing::max_timeout) << std::endl;
+
+	return 0;
+}
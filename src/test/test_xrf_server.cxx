@@ -0,0 +1,156 @@
+//
+// d-gate: d-star packet router <https://git.unix.dog/nullobsi/dgate/>
+//
+// SPDX-FileCopyrightText: 2025 Juan Pablo Zendejas <nullobsi@unix.dog>
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+//   2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+//   3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+#include "dlink/xrf_server.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <unistd.h>
+
+static int udp_socket(sockaddr_storage& addr)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	auto sin = reinterpret_cast<sockaddr_in*>(&addr);
+	std::memset(&addr, 0, sizeof(addr));
+	sin->sin_family = AF_INET;
+	sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	bind(fd, (sockaddr*)sin, sizeof(sockaddr_in));
+	socklen_t len = sizeof(sockaddr_in);
+	getsockname(fd, (sockaddr*)sin, &len);
+	return fd;
+}
+
+// Sends on a socket the test already bound instead of the XRF port.
+struct test_io : dlink::udp_engine {
+	test_io(ev::loop_ref loop, int fd) : udp_engine(loop, "test")
+	{
+		sock_v4_ = fd;
+	}
+};
+
+static bool recv_len(int fd, size_t want, dlink::xrf_packet& p)
+{
+	timeval tv = {0, 200000};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	return recv(fd, &p, sizeof(p), 0) == (ssize_t)want;
+}
+
+int main()
+{
+	ev::dynamic_loop loop;
+
+	sockaddr_storage server_addr;
+	int server = udp_socket(server_addr);
+	test_io io(loop, server);
+	dlink::xrf_server srv(loop, "XRF999", {'A', 'B'}, io);
+
+	sockaddr_storage addr[3];
+	int gw[3];
+	const char* names[3] = {"W1AAA", "W2BBB", "W3CCC"};
+
+	for (int i = 0; i < 3; i++) {
+		gw[i] = udp_socket(addr[i]);
+
+		dlink::xrf_packet p;
+		dv::callsign(names[i]).to_field(p.link.from);
+		p.link.mod_from = 'C';
+		p.link.mod_to = 'A';
+		p.link.null = 0;
+		srv.handle_packet(p, sizeof(dlink::xrf_packet_link), addr[i]);
+
+		dlink::xrf_packet ack;
+		std::cout << (recv_len(gw[i], sizeof(dlink::xrf_packet_link_ack), ack) && ack.is_ack() && ack.ack.ack[0] == 'A');
+	}
+	std::cout << (srv.peers() == 3) << std::endl;
+
+	// Unknown module is refused.
+	dlink::xrf_packet p;
+	dv::callsign("W4DDD").to_field(p.link.from);
+	p.link.mod_from = 'C';
+	p.link.mod_to = 'Z';
+	p.link.null = 0;
+	sockaddr_storage extra_addr;
+	int extra = udp_socket(extra_addr);
+	srv.handle_packet(p, sizeof(dlink::xrf_packet_link), extra_addr);
+	dlink::xrf_packet nak;
+	std::cout << (recv_len(extra, sizeof(dlink::xrf_packet_link_ack), nak) && nak.ack.ack[0] == 'N') << (srv.peers() == 3) << std::endl;
+
+	// A header from the first gateway goes to the other two only.
+	dlink::xrf_packet h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.header.title, "DSVT", 4);
+	h.header.config = 0x10U;
+	h.header.id = 0x20U;
+	h.header.ctrl = 0x80U;
+	h.header.streamid = 0x1234;
+	dv::callsign("W1AAA  C").to_field(h.header.header.departure_rptr_cs);
+	std::cout << srv.handle_packet(h, sizeof(dlink::xrf_packet_header), addr[0]);
+
+	dlink::xrf_packet r;
+	std::cout << recv_len(gw[1], sizeof(dlink::xrf_packet_header), r) << (r.header.header.destination_rptr() == dv::callsign("XRF999 A"));
+	std::cout << recv_len(gw[2], sizeof(dlink::xrf_packet_header), r) << !recv_len(gw[0], sizeof(dlink::xrf_packet_header), r) << std::endl;
+
+	// Voice, then the end of the stream.
+	dlink::xrf_packet v;
+	std::memset(&v, 0, sizeof(v));
+	std::memcpy(v.voice.title, "DSVT", 4);
+	v.voice.config = 0x20U;
+	v.voice.id = 0x20U;
+	v.voice.streamid = 0x1234;
+
+	// The same stream id from someone else isn't ours, and is left for
+	// the links.
+	v.voice.seqno = 1;
+	std::cout << !srv.handle_packet(v, sizeof(dlink::xrf_packet_voice), extra_addr) << !srv.handle_packet(h, sizeof(dlink::xrf_packet_header), extra_addr);
+	std::cout << !recv_len(gw[1], sizeof(dlink::xrf_packet_voice), r) << std::endl;
+
+	v.voice.seqno = 0x40U | 3;
+	std::cout << srv.handle_packet(v, sizeof(dlink::xrf_packet_voice), addr[0]);
+	std::cout << recv_len(gw[1], sizeof(dlink::xrf_packet_voice), r) << recv_len(gw[2], sizeof(dlink::xrf_packet_voice), r);
+	std::cout << !srv.handle_packet(v, sizeof(dlink::xrf_packet_voice), addr[0]) << std::endl;
+
+	// Another address can't take over a live gateway's links.
+	dv::callsign("W1AAA").to_field(p.link.from);
+	p.link.mod_to = 'B';
+	srv.handle_packet(p, sizeof(dlink::xrf_packet_link), extra_addr);
+	std::cout << (recv_len(extra, sizeof(dlink::xrf_packet_link_ack), nak) && nak.ack.ack[0] == 'N') << (srv.peers() == 3) << std::endl;
+
+	for (int i = 0; i < 3; i++)
+		close(gw[i]);
+	close(extra);
+	return 0;
+}